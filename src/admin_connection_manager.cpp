@@ -1,10 +1,12 @@
 #include "admin_connection_manager.h"
 
+#include "buffered_connection.h"
+#include "util/counters.h"
+#include "util/latency.h"
 #include "util/log.h"
 #include "util/maybe.h"
 #include "util/string.h"
 
-#include <Poco/Net/NetException.h>
 #include <Poco/Net/TCPServer.h>
 
 #include <atomic>
@@ -66,17 +68,24 @@ private:
 
 class AdminConnectionFilter : public TCPServerConnectionFilter {
 public:
-    explicit AdminConnectionFilter(ConnectionOwner& uniqueConnection)
+    AdminConnectionFilter(ConnectionOwner& uniqueConnection, AdmissionControl& admission)
         : UniqueConnection(uniqueConnection)
+        , Admission(admission)
     {
     }
 
     bool accept(const StreamSocket& socket) override {
-        return UniqueConnection.TryOwn();
+        const bool accepted = Admission.Admit(socket.peerAddress().host(), AdmissionControl::Kind::ADMIN)
+                              && UniqueConnection.TryOwn();
+        Counters().Add(accepted
+                       ? ServerCounter::ADMIN_CONNECTIONS_ACCEPTED
+                       : ServerCounter::ADMIN_CONNECTIONS_REJECTED);
+        return accepted;
     }
 
 private:
     ConnectionOwner& UniqueConnection;
+    AdmissionControl& Admission;
 };
 
 struct ConnectionContext {
@@ -101,15 +110,14 @@ private:
     ConnectionContext& Ctx;
 };
 
-class AdminConnection final : public TCPServerConnection {
+class AdminConnection final : public BufferedConnection {
 public:
     AdminConnection(const StreamSocket& socket, ConnectionContext& ctx)
-        : TCPServerConnection(socket)
-        , Socket(this->socket())
+        : BufferedConnection(socket, OutputQueue::Limits())
         , Ctx(ctx)
     {
-        Socket.setBlocking(true);
         Log().Info() << "Admin connection open";
+        Log().Info() << "New admin connection from: " << Socket.peerAddress().toString();
     }
 
     ~AdminConnection() {
@@ -121,74 +129,33 @@ public:
         }
     }
 
-    void run() override {
-        Log().Info() << "New admin connection from: " << Socket.peerAddress().toString();
-        while (IsOpen) {
-            try {
-                auto bytesReceived = ReceiveBytes();
-                if (bytesReceived <= 0) {
-                    IsOpen = false;
-                } else {
-                    const auto answer = OnReceive(static_cast<size_t>(bytesReceived));
-                    if (answer) {
-                        SendAnswer(*answer);
-                    }
-                }
-            } catch (Poco::Net::ConnectionResetException&) {
-                Log().Warn() << "Admin connection was resetted";
-                IsOpen = false;
-            } catch (Poco::Exception& ex) {
-                Log().Error() << "Admin connection closed due to error: " << ex.what();
-                IsOpen = false;
-            }
-        }
-    }
-
 private:
-    static constexpr size_t RECEIVE_BYTES_MAX = 1024;
-
-    StreamSocket& Socket;
     ConnectionContext& Ctx;
-    char ReceiveBuffer[RECEIVE_BYTES_MAX];
-    bool IsOpen = true;
     bool StopOnConnectionClose = false;
 
 private:
-    int ReceiveBytes() {
-        return Socket.receiveBytes(ReceiveBuffer, RECEIVE_BYTES_MAX);
-    }
-
-    void SendAnswer(const String& answer) {
-        if (answer.size() == 0) {
-            return;
+    void OnReceive(StringView data) override {
+        const auto answer = OnCommand(Strip(data));
+        if (answer && !answer->empty()) {
+            // Answers are NUL-terminated on the wire
+            Send(*answer + '\0');
         }
-
-        const size_t bytesToSend = answer.size() + 1;
-        int bytesSent = Socket.sendBytes(answer.c_str(), bytesToSend);
-        if (bytesSent < 0) {
-            Log().Error() << "AdminServer is in unknown state: " << bytesSent;
-        }
-
-        if (static_cast<size_t>(bytesSent) < bytesToSend) {
-            Log().Error() << "AdminServer was sending " << bytesToSend
-                          << " bytes but it is able to send only " << bytesSent;
-        }
-    }
-
-    StringView GetCommand(size_t amountBytes) {
-        if (amountBytes >= RECEIVE_BYTES_MAX) {
-            amountBytes = RECEIVE_BYTES_MAX;
-        }
-        return {ReceiveBuffer, amountBytes};
     }
 
-    Maybe<String> OnReceive(size_t amountBytes) {
-        auto command = Strip(GetCommand(amountBytes));
+    Maybe<String> OnCommand(StringView command) {
+        Counters().Add(ServerCounter::ADMIN_COMMANDS);
         if (command == "STOP") {
             StopOnConnectionClose = true;
-            IsOpen = false;
+            Close();
             return Nothing<String>();
         }
+        if (command == "LATENCY") {
+            return Latency().Dump();
+        }
+        if (command == "LATENCY RESET") {
+            Latency().Reset();
+            return "OK\n";
+        }
 
         return "Unknown command\n";
     }
@@ -196,12 +163,12 @@ private:
 
 class AdminConnectionManager final : public IAdminConnectionManager {
 public:
-    explicit AdminConnectionManager(const ServerConfig& config)
+    AdminConnectionManager(const ServerConfig& config, AdmissionControl& admission)
         : Ctx({Waiter, UniqueConnection})
         , Server(new AdminConnectionFactory<AdminConnection>(Ctx), config.AdminPort)
     {
         Log().Info() << "Admin server is listening for connections on port " << config.AdminPort;
-        Server.setConnectionFilter(new AdminConnectionFilter(UniqueConnection));
+        Server.setConnectionFilter(new AdminConnectionFilter(UniqueConnection, admission));
     }
 
     ~AdminConnectionManager() {
@@ -241,6 +208,7 @@ private:
     }
 };
 
-Holder<IAdminConnectionManager> IAdminConnectionManager::Create(const ServerConfig& config) {
-    return MakeHolder<AdminConnectionManager>(config);
+Holder<IAdminConnectionManager> IAdminConnectionManager::Create(const ServerConfig& config,
+                                                                AdmissionControl& admission) {
+    return MakeHolder<AdminConnectionManager>(config, admission);
 }
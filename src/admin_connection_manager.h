@@ -1,12 +1,13 @@
 #pragma once
 
+#include "admission_control.h"
 #include "server_config.h"
 #include "termination.h"
 #include "util/holder.h"
 
 class IAdminConnectionManager : public ITerminationController {
 public:
-    static Holder<IAdminConnectionManager> Create(const ServerConfig& config);
+    static Holder<IAdminConnectionManager> Create(const ServerConfig& config, AdmissionControl& admission);
 
 public:
     virtual ~IAdminConnectionManager() = default;
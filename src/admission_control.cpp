@@ -0,0 +1,172 @@
+#include "admission_control.h"
+
+#include "util/counters.h"
+#include "util/log.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    constexpr auto SAMPLE_INTERVAL = std::chrono::seconds(1);
+    constexpr f64 SHED_PERCENTILE = 99;
+
+    // Histograms only grow between resets, a shrinking bucket means LATENCY RESET happened
+    LatencySnapshot WindowOf(const LatencySnapshot& current, const LatencySnapshot& previous) {
+        if (current.TotalCount < previous.TotalCount) {
+            return current;
+        }
+        LatencySnapshot window;
+        for (size_t i = 0; i < window.Counts.size(); ++i) {
+            window.Counts[i] = current.Counts[i] >= previous.Counts[i] ? current.Counts[i] - previous.Counts[i] : 0;
+            window.TotalCount += window.Counts[i];
+        }
+        window.Sum = current.Sum - std::min(current.Sum, previous.Sum);
+        window.Max = current.Max;
+        return window;
+    }
+}
+
+bool AdmissionControl::AddressKey::operator==(const AddressKey& other) const {
+    return Length == other.Length && Bytes == other.Bytes;
+}
+
+size_t AdmissionControl::AddressKeyHash::operator()(const AddressKey& key) const {
+    // FNV-1a
+    u64 hash = 14695981039346656037ull;
+    for (u8 i = 0; i < key.Length; ++i) {
+        hash = (hash ^ key.Bytes[i]) * 1099511628211ull;
+    }
+    return static_cast<size_t>(hash);
+}
+
+AdmissionControl::AdmissionControl(const ServerConfig& config)
+    : RefillPerSecond(config.AdmissionConnectionsPerSec)
+    , Burst(config.AdmissionBurst)
+    , ShedMoveLatencyNs(u64(config.ShedMoveLatencyUs) * 1000)
+    , ShedQueueDepth(config.ShedQueueDepth)
+{
+#if !defined(MINESWEEPER_LATENCY_PROBES)
+    if (ShedMoveLatencyNs > 0) {
+        Log().Warn() << "shed_move_latency_us has no effect, latency probes are compiled out";
+    }
+#endif
+}
+
+AdmissionControl::~AdmissionControl() {
+    OnTerminate();
+}
+
+bool AdmissionControl::Admit(const Poco::Net::IPAddress& address, Kind kind) {
+    if (kind != Kind::ADMIN && Shedding.load(std::memory_order_relaxed)) {
+        Counters().Add(ServerCounter::ADMISSION_SHED);
+        return false;
+    }
+    if (kind != Kind::ROUTED_PLAYER && !TakeToken(ToKey(address), Clock::now())) {
+        Counters().Add(ServerCounter::ADMISSION_RATE_LIMITED);
+        return false;
+    }
+    return true;
+}
+
+void AdmissionControl::AddQueueDepthSource(QueueDepthSource source) {
+    QueueDepthSources.push_back(std::move(source));
+}
+
+void AdmissionControl::Start() {
+    PreviousCommands = Latency().Collect(LatencyProbe::PLAYER_COMMAND);
+    Sampler = std::thread([this]() { RunSampler(); });
+}
+
+void AdmissionControl::OnTerminate() {
+    {
+        std::lock_guard<std::mutex> lock(SamplerMutex);
+        ShouldStop = true;
+        SamplerCv.notify_all();
+    }
+    if (Sampler.joinable()) {
+        Sampler.join();
+    }
+}
+
+bool AdmissionControl::IsShedding() const {
+    return Shedding.load(std::memory_order_relaxed);
+}
+
+AdmissionControl::AddressKey AdmissionControl::ToKey(const Poco::Net::IPAddress& address) {
+    AddressKey key;
+    key.Length = static_cast<u8>(std::min<size_t>(address.length(), key.Bytes.size()));
+    std::memcpy(key.Bytes.data(), address.addr(), key.Length);
+    return key;
+}
+
+bool AdmissionControl::TakeToken(const AddressKey& key, Clock::time_point now) {
+    auto& shard = Shards[AddressKeyHash()(key) % SHARD_COUNT];
+    std::lock_guard<std::mutex> lock(shard.Mutex);
+    auto [it, inserted] = shard.Buckets.try_emplace(key, TokenBucket{Burst, now});
+    auto& bucket = it->second;
+    if (!inserted) {
+        const std::chrono::duration<f64> elapsed = now - bucket.UpdatedAt;
+        bucket.Tokens = std::min(Burst, bucket.Tokens + elapsed.count() * RefillPerSecond);
+        bucket.UpdatedAt = now;
+    }
+    if (bucket.Tokens < 1) {
+        return false;
+    }
+    bucket.Tokens -= 1;
+    return true;
+}
+
+void AdmissionControl::RunSampler() {
+    std::unique_lock<std::mutex> lock(SamplerMutex);
+    while (!SamplerCv.wait_for(lock, SAMPLE_INTERVAL, [this]() { return ShouldStop; })) {
+        lock.unlock();
+        Sample();
+        lock.lock();
+    }
+}
+
+void AdmissionControl::Sample() {
+    bool overloaded = false;
+
+    const auto commands = Latency().Collect(LatencyProbe::PLAYER_COMMAND);
+    const auto window = WindowOf(commands, PreviousCommands);
+    PreviousCommands = commands;
+    const u64 commandLatency = window.Percentile(SHED_PERCENTILE);
+    if (ShedMoveLatencyNs > 0 && commandLatency > ShedMoveLatencyNs) {
+        overloaded = true;
+    }
+
+    size_t queueDepth = 0;
+    for (const auto& source : QueueDepthSources) {
+        queueDepth += source();
+    }
+    if (ShedQueueDepth > 0 && queueDepth > ShedQueueDepth) {
+        overloaded = true;
+    }
+
+    if (Shedding.exchange(overloaded) != overloaded) {
+        if (overloaded) {
+            Log().Warn() << "Shedding new player connections: command p99 " << commandLatency
+                         << "ns, accept queue " << queueDepth;
+        } else {
+            Log().Info() << "Load is back to normal, accepting player connections";
+        }
+    }
+
+    EvictIdleBuckets(Clock::now());
+}
+
+// A bucket which has refilled completely carries no information
+void AdmissionControl::EvictIdleBuckets(Clock::time_point now) {
+    for (auto& shard : Shards) {
+        std::lock_guard<std::mutex> lock(shard.Mutex);
+        for (auto it = shard.Buckets.begin(); it != shard.Buckets.end();) {
+            const std::chrono::duration<f64> idle = now - it->second.UpdatedAt;
+            if (it->second.Tokens + idle.count() * RefillPerSecond >= Burst) {
+                it = shard.Buckets.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
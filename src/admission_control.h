@@ -0,0 +1,109 @@
+#pragma once
+
+#include "server_config.h"
+#include "termination.h"
+#include "types.h"
+#include "util/latency.h"
+
+#include <Poco/Net/IPAddress.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Decides whether a freshly accepted socket may become a connection. It is
+// called from connection filters, so a rejected peer never gets a thread,
+// buffers or a session.
+//
+// Every source address has a token bucket, buckets live in a sharded hash so
+// accepts from different addresses rarely share a lock. On top of that player
+// connections are shed altogether while the server is overloaded: a sampler
+// thread watches windowed player command latency and the listeners' accept
+// queues and flips a flag the filters read.
+class AdmissionControl final : public ITerminationListener {
+public:
+    enum class Kind : u8 {
+        PLAYER,
+        // A player relayed by the cluster router, which rate-limits the
+        // player's own address already. Only shed, every connection comes
+        // from the router's address.
+        ROUTED_PLAYER,
+        // Never shed, an operator must always be able to reach the server
+        ADMIN
+    };
+
+    using QueueDepthSource = std::function<size_t()>;
+
+public:
+    explicit AdmissionControl(const ServerConfig& config);
+    ~AdmissionControl();
+
+    bool Admit(const Poco::Net::IPAddress& address, Kind kind);
+
+    // Sources must be added before Start
+    void AddQueueDepthSource(QueueDepthSource source);
+
+    void Start();
+    void OnTerminate() override;
+
+    bool IsShedding() const;
+
+public:
+    AdmissionControl(const AdmissionControl&) = delete;
+    AdmissionControl& operator=(const AdmissionControl&) = delete;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct AddressKey {
+        std::array<u8, 16> Bytes = {};
+        u8 Length = 0;
+
+        bool operator==(const AddressKey& other) const;
+    };
+
+    struct AddressKeyHash {
+        size_t operator()(const AddressKey& key) const;
+    };
+
+    struct TokenBucket {
+        f64 Tokens = 0;
+        Clock::time_point UpdatedAt;
+    };
+
+    struct Shard {
+        std::mutex Mutex;
+        std::unordered_map<AddressKey, TokenBucket, AddressKeyHash> Buckets;
+    };
+
+    static constexpr size_t SHARD_COUNT = 16;
+
+private:
+    const f64 RefillPerSecond;
+    const f64 Burst;
+    const u64 ShedMoveLatencyNs;
+    const size_t ShedQueueDepth;
+
+    std::array<Shard, SHARD_COUNT> Shards;
+    std::vector<QueueDepthSource> QueueDepthSources;
+    std::atomic<bool> Shedding = {false};
+    LatencySnapshot PreviousCommands;
+
+    std::mutex SamplerMutex;
+    std::condition_variable SamplerCv;
+    bool ShouldStop = false;
+    std::thread Sampler;
+
+private:
+    static AddressKey ToKey(const Poco::Net::IPAddress& address);
+    bool TakeToken(const AddressKey& key, Clock::time_point now);
+    void RunSampler();
+    void Sample();
+    void EvictIdleBuckets(Clock::time_point now);
+};
@@ -1,14 +1,70 @@
 #include "application.h"
 
+#include "cluster_router.h"
 #include "util/log.h"
 
+Application::GameServices::GameServices(const ServerConfig& config)
+    : Board(config.LeaderboardPath, std::chrono::seconds(config.LeaderboardSnapshotIntervalSec))
+    , Sessions(FirstSessionId(config), SessionIdStride(config))
+    , Spectators(Sessions, std::chrono::milliseconds(config.SpectatorTickMs))
+    , Lobby(Sessions, Board, {config.MatchmakingQueueCapacity, config.MatchSize,
+                              std::chrono::milliseconds(config.MatchWaitMs)})
+    , Udp(IUdpMoveTransport::Create(config, Board))
+{
+}
+
 Application::Application(int argc, const char** argv)
     : Config(ParseArguments(argc, argv))
-    , AdminConnections(IAdminConnectionManager::Create(Config))
+    , Admission(Config)
+    , AdminConnections(IAdminConnectionManager::Create(Config, Admission))
+    , Metrics(IMetricsServer::Create(Config))
 {
+    if (IsClusterRouter(Config)) {
+        Workers = MakeHolder<WorkerPool>(Config);
+        PlayerConnections = IClusterRouter::Create(Config, Admission);
+    } else {
+        Game = MakeHolder<GameServices>(Config);
+        PlayerConnections = IPlayerConnectionManager::Create(
+            Config, {Game->Board, Game->Sessions, Game->Spectators, Game->Lobby, Admission, Game->Udp.get()});
+    }
+
+    AdminConnections->AddTerminationListener(*PlayerConnections);
+    if (Workers) {
+        AdminConnections->AddTerminationListener(*Workers);
+    }
+    if (Game) {
+        if (Game->Udp) {
+            AdminConnections->AddTerminationListener(*Game->Udp);
+        }
+        AdminConnections->AddTerminationListener(Game->Lobby);
+        AdminConnections->AddTerminationListener(Game->Spectators);
+    }
+    AdminConnections->AddTerminationListener(Admission);
+    if (Game) {
+        AdminConnections->AddTerminationListener(Game->Board);
+    }
+    if (Metrics) {
+        AdminConnections->AddTerminationListener(*Metrics);
+    }
 }
 
 int Application::Run() {
+    if (Metrics) {
+        Metrics->Start();
+    }
+    Admission.Start();
+    if (Workers) {
+        Workers->Start();
+    }
+    if (Game) {
+        Game->Board.Start();
+        Game->Spectators.Start();
+        Game->Lobby.Start();
+        if (Game->Udp) {
+            Game->Udp->Start();
+        }
+    }
+    PlayerConnections->Start();
     AdminConnections->Start();
     AdminConnections->Wait();
 
@@ -1,7 +1,14 @@
 #pragma once
 
 #include "admin_connection_manager.h"
+#include "admission_control.h"
+#include "cluster.h"
+#include "game/leaderboard.h"
+#include "game/matchmaker.h"
+#include "metrics_server.h"
+#include "player_connection_manager.h"
 #include "server_config.h"
+#include "udp_transport.h"
 
 class Application {
 public:
@@ -17,10 +24,27 @@ public:
         return instance;
     }
 
+private:
+    // Everything a process serving games owns, a cluster router has none of it
+    struct GameServices {
+        Leaderboard Board;
+        SessionRegistry Sessions;
+        SpectatorHub Spectators;
+        Matchmaker Lobby;
+        Holder<IUdpMoveTransport> Udp;
+
+        explicit GameServices(const ServerConfig& config);
+    };
+
 private:
     explicit Application(int argc, const char** argv);
 
 private:
     ServerConfig Config;
+    AdmissionControl Admission;
     Holder<IAdminConnectionManager> AdminConnections;
+    Holder<IMetricsServer> Metrics;
+    Holder<GameServices> Game;
+    Holder<WorkerPool> Workers;
+    Holder<IPlayerConnectionManager> PlayerConnections;
 };
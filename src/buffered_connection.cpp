@@ -0,0 +1,111 @@
+#include "buffered_connection.h"
+
+#include "util/latency.h"
+#include "util/log.h"
+
+#include <Poco/Net/NetException.h>
+#include <Poco/Timespan.h>
+
+using namespace Poco::Net;
+
+BufferedConnection::BufferedConnection(const StreamSocket& socket, const OutputQueue::Limits& limits)
+    : TCPServerConnection(socket)
+    , Socket(this->socket())
+    , Output(limits)
+{
+    Socket.setBlocking(false);
+}
+
+void BufferedConnection::run() {
+    while (IsOpen && !ShouldStop()) {
+        try {
+            OnTick();
+            if (!IsOpen) {
+                break;
+            }
+
+            int mode = 0;
+            if (!Output.IsBacklogged()) {
+                mode |= Socket::SELECT_READ;
+            }
+            if (!Output.IsEmpty()) {
+                mode |= Socket::SELECT_WRITE;
+            }
+            const Poco::Timespan timeout(PollTimeoutUs());
+            auto* wakeup = ActiveWakeup();
+            if (!(wakeup ? wakeup->Poll(Socket, timeout, mode) : Socket.poll(timeout, mode))) {
+                continue;
+            }
+
+            if (!Output.IsEmpty()) {
+                FlushOutput();
+            }
+            if (IsOpen && !Output.IsBacklogged()) {
+                ReceiveAvailable();
+            }
+        } catch (Poco::Net::ConnectionResetException&) {
+            IsOpen = false;
+            IsBroken = true;
+        } catch (Poco::Exception& ex) {
+            Log().Error() << "Connection closed due to error: " << ex.displayText();
+            IsOpen = false;
+            IsBroken = true;
+        }
+    }
+    FlushBeforeClose();
+}
+
+void BufferedConnection::Send(String message) {
+    Output.Push(std::move(message));
+}
+
+void BufferedConnection::Send(const SharedBuffer& buffer) {
+    Output.Push(buffer);
+}
+
+void BufferedConnection::Close() {
+    IsOpen = false;
+}
+
+bool BufferedConnection::IsClosed() const {
+    return !IsOpen;
+}
+
+bool BufferedConnection::IsSendBacklogged() const {
+    return Output.IsBacklogged();
+}
+
+void BufferedConnection::ReceiveAvailable() {
+    int bytesReceived = 0;
+    {
+        LATENCY_SCOPE(LatencyProbe::SOCKET_RECEIVE);
+        bytesReceived = Socket.receiveBytes(ReceiveBuffer, RECEIVE_BYTES_MAX);
+    }
+
+    // Negative result means there is nothing to read yet
+    if (bytesReceived == 0) {
+        IsOpen = false;
+    } else if (bytesReceived > 0) {
+        OnReceive({ReceiveBuffer, static_cast<size_t>(bytesReceived)});
+        // Most answers fit the socket buffer right away, don't wait another poll for them
+        FlushOutput();
+    }
+}
+
+void BufferedConnection::FlushOutput() {
+    if (Output.Flush(Socket) == OutputQueue::FlushStatus::FAILED) {
+        IsOpen = false;
+        IsBroken = true;
+    }
+}
+
+void BufferedConnection::FlushBeforeClose() {
+    const Poco::Timespan timeout(CLOSE_FLUSH_TIMEOUT_US);
+    try {
+        while (!IsBroken && !Output.IsEmpty() && Socket.poll(timeout, Socket::SELECT_WRITE)) {
+            FlushOutput();
+        }
+    } catch (Poco::Exception&) {
+        // The peer is gone, nothing left to deliver
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "output_queue.h"
+#include "poll_wakeup.h"
+#include "util/string.h"
+
+#include <Poco/Net/StreamSocket.h>
+#include <Poco/Net/TCPServerConnection.h>
+
+// Non-blocking connection loop shared by every connection type: reads are
+// handed to OnReceive, answers go through an OutputQueue which is flushed
+// whenever the socket is writable, and reading is paused while the peer
+// doesn't drain what was already queued for it.
+class BufferedConnection : public Poco::Net::TCPServerConnection {
+public:
+    BufferedConnection(const Poco::Net::StreamSocket& socket, const OutputQueue::Limits& limits);
+
+    void run() override;
+
+protected:
+    static constexpr long POLL_TIMEOUT_US = 250 * 1000;
+
+    Poco::Net::StreamSocket& Socket;
+
+protected:
+    virtual void OnReceive(StringView data) = 0;
+
+    // Called once per loop iteration before polling the socket
+    virtual void OnTick() {}
+    virtual long PollTimeoutUs() const { return POLL_TIMEOUT_US; }
+    // When set the poll also ends once it is signalled, for OnTick work
+    // which other threads hand over
+    virtual PollWakeup* ActiveWakeup() { return nullptr; }
+    virtual bool ShouldStop() const { return false; }
+
+    void Send(String message);
+    void Send(const SharedBuffer& buffer);
+
+    // Stops reading, output queued so far is still delivered
+    void Close();
+    bool IsClosed() const;
+    bool IsSendBacklogged() const;
+
+private:
+    static constexpr size_t RECEIVE_BYTES_MAX = 4096;
+    static constexpr long CLOSE_FLUSH_TIMEOUT_US = 1000 * 1000;
+
+    OutputQueue Output;
+    char ReceiveBuffer[RECEIVE_BYTES_MAX];
+    bool IsOpen = true;
+    bool IsBroken = false;
+
+private:
+    void ReceiveAvailable();
+    void FlushOutput();
+    void FlushBeforeClose();
+};
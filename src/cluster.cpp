@@ -0,0 +1,160 @@
+#include "cluster.h"
+
+#include "util/log.h"
+
+#include <Poco/Exception.h>
+#include <Poco/File.h>
+#include <Poco/Path.h>
+#include <Poco/Net/StreamSocket.h>
+
+using namespace Poco::Net;
+
+namespace {
+    constexpr auto SUPERVISE_INTERVAL = std::chrono::seconds(1);
+    constexpr auto STOP_TIMEOUT = std::chrono::seconds(5);
+    constexpr auto STOP_POLL_INTERVAL = std::chrono::milliseconds(50);
+    constexpr long CONNECT_TIMEOUT_US = 1000 * 1000;
+    constexpr auto LOOPBACK = "127.0.0.1";
+
+#if defined(POCO_HAS_UNIX_SOCKET)
+    String WorkerSocketPath(const ServerConfig& config, u16 workerIndex) {
+        Poco::Path path(config.ClusterSocketDir ? *config.ClusterSocketDir : Poco::Path::temp());
+        path.makeDirectory();
+        path.setFileName("minesweeper-" + std::to_string(config.GamePort) + "-" + std::to_string(workerIndex) + ".sock");
+        return path.toString();
+    }
+#endif
+}
+
+u16 WorkerOf(u64 sessionId, u16 workerCount) {
+    return static_cast<u16>(sessionId % workerCount);
+}
+
+u64 FirstSessionId(const ServerConfig& config) {
+    return config.WorkerIndex ? u64(config.WorkerCount) + *config.WorkerIndex : 1;
+}
+
+u64 SessionIdStride(const ServerConfig& config) {
+    return config.WorkerIndex ? config.WorkerCount : 1;
+}
+
+SocketAddress WorkerAddress(const ServerConfig& config, u16 workerIndex) {
+#if defined(POCO_HAS_UNIX_SOCKET)
+    return SocketAddress(SocketAddress::UNIX_LOCAL, WorkerSocketPath(config, workerIndex));
+#else
+    // Like admin ports, worker game ports follow the router's
+    return SocketAddress(String(LOOPBACK), static_cast<u16>(config.GamePort + 1 + workerIndex));
+#endif
+}
+
+SocketAddress WorkerAdminAddress(const ServerConfig& config, u16 workerIndex) {
+    return SocketAddress(String(LOOPBACK), static_cast<u16>(config.AdminPort + 1 + workerIndex));
+}
+
+ServerSocket ListenForPlayers(const ServerConfig& config) {
+    if (!config.WorkerIndex) {
+        return ServerSocket(config.GamePort);
+    }
+#if defined(POCO_HAS_UNIX_SOCKET)
+    // A crashed predecessor leaves its socket file behind
+    Poco::File stale(WorkerSocketPath(config, *config.WorkerIndex));
+    if (stale.exists()) {
+        stale.remove();
+    }
+#endif
+    return ServerSocket(WorkerAddress(config, *config.WorkerIndex));
+}
+
+WorkerPool::WorkerPool(const ServerConfig& config)
+    : Config(config)
+    , Workers(config.WorkerCount)
+{
+    for (u16 i = 0; i < Workers.size(); ++i) {
+        Workers[i].Index = i;
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    OnTerminate();
+}
+
+void WorkerPool::Start() {
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        for (auto& worker : Workers) {
+            Launch(worker);
+        }
+    }
+    Supervisor = std::thread([this]() { RunSupervisor(); });
+}
+
+void WorkerPool::OnTerminate() {
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        if (ShouldStop) {
+            return;
+        }
+        ShouldStop = true;
+        Cv.notify_all();
+    }
+    if (Supervisor.joinable()) {
+        Supervisor.join();
+    }
+    for (auto& worker : Workers) {
+        Stop(worker);
+    }
+}
+
+void WorkerPool::Launch(Worker& worker) {
+    const Poco::Process::Args args = {"--config", Config.ConfigPath, "--worker", std::to_string(worker.Index)};
+    try {
+        worker.Process = Poco::Process::launch(Config.ExecutablePath, args);
+        Log().Info() << "Worker " << worker.Index << " started with pid " << worker.Process->id();
+    } catch (const Poco::Exception& ex) {
+        worker.Process.reset();
+        Log().Error() << "Cannot start worker " << worker.Index << ": " << ex.displayText();
+    }
+}
+
+// A dead worker only takes its own games down, the rest keep running while it restarts
+void WorkerPool::RunSupervisor() {
+    std::unique_lock<std::mutex> lock(Mutex);
+    while (!Cv.wait_for(lock, SUPERVISE_INTERVAL, [this]() { return ShouldStop; })) {
+        for (auto& worker : Workers) {
+            if (worker.Process && worker.Process->tryWait() == -1) {
+                continue;
+            }
+            ++worker.Restarts;
+            Log().Warn() << "Worker " << worker.Index << " is down, restart #" << worker.Restarts;
+            Launch(worker);
+        }
+    }
+}
+
+void WorkerPool::Stop(Worker& worker) {
+    if (!worker.Process) {
+        return;
+    }
+
+    try {
+        StreamSocket admin;
+        admin.connect(WorkerAdminAddress(Config, worker.Index), Poco::Timespan(CONNECT_TIMEOUT_US));
+        const String command = "STOP";
+        admin.sendBytes(command.data(), static_cast<int>(command.size()));
+    } catch (const Poco::Exception& ex) {
+        Log().Warn() << "Cannot send STOP to worker " << worker.Index << ": " << ex.displayText();
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + STOP_TIMEOUT;
+    while (worker.Process->tryWait() == -1) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            Log().Warn() << "Worker " << worker.Index << " did not stop in time, killing it";
+            Poco::Process::kill(*worker.Process);
+            worker.Process->wait();
+            break;
+        }
+        std::this_thread::sleep_for(STOP_POLL_INTERVAL);
+    }
+    worker.Process.reset();
+    Log().Info() << "Worker " << worker.Index << " stopped";
+}
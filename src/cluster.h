@@ -0,0 +1,71 @@
+#pragma once
+
+#include "server_config.h"
+#include "termination.h"
+#include "types.h"
+#include "util/maybe.h"
+
+#include <Poco/Net/ServerSocket.h>
+#include <Poco/Net/SocketAddress.h>
+#include <Poco/Process.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Cluster mode runs one router process, which owns the public ports, and
+// worker_count worker processes, each with its own heap and its own games.
+// A session lives on the worker whose index is its id modulo the worker
+// count, so the router can find it from the id alone.
+
+inline bool IsClusterRouter(const ServerConfig& config) {
+    return config.WorkerCount > 0 && !config.WorkerIndex;
+}
+
+u16 WorkerOf(u64 sessionId, u16 workerCount);
+u64 FirstSessionId(const ServerConfig& config);
+u64 SessionIdStride(const ServerConfig& config);
+
+// Unix domain socket where the platform has them, loopback TCP otherwise
+Poco::Net::SocketAddress WorkerAddress(const ServerConfig& config, u16 workerIndex);
+Poco::Net::SocketAddress WorkerAdminAddress(const ServerConfig& config, u16 workerIndex);
+
+// The public game port for a single process, the router-facing socket for a worker
+Poco::Net::ServerSocket ListenForPlayers(const ServerConfig& config);
+
+// Launches the workers, restarts the ones which die and stops all of them
+// when the router is stopped
+class WorkerPool final : public ITerminationListener {
+public:
+    explicit WorkerPool(const ServerConfig& config);
+    ~WorkerPool();
+
+    void Start();
+    void OnTerminate() override;
+
+public:
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+private:
+    struct Worker {
+        u16 Index = 0;
+        Maybe<Poco::ProcessHandle> Process;
+        u32 Restarts = 0;
+    };
+
+private:
+    const ServerConfig& Config;
+    std::vector<Worker> Workers;
+
+    std::mutex Mutex;
+    std::condition_variable Cv;
+    bool ShouldStop = false;
+    std::thread Supervisor;
+
+private:
+    void Launch(Worker& worker);
+    void RunSupervisor();
+    void Stop(Worker& worker);
+};
@@ -0,0 +1,263 @@
+#include "cluster_router.h"
+
+#include "cluster.h"
+#include "util/counters.h"
+#include "util/log.h"
+#include "util/maybe.h"
+#include "util/string.h"
+
+#include <Poco/Net/NetException.h>
+#include <Poco/Net/ServerSocket.h>
+#include <Poco/Net/StreamSocket.h>
+#include <Poco/Net/TCPServer.h>
+#include <Poco/ThreadPool.h>
+#include <Poco/Timespan.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+using namespace Poco::Net;
+
+namespace {
+    constexpr size_t LINE_LENGTH_MAX = 256;
+    constexpr size_t RELAY_BYTES_MAX = 16 * 1024;
+    constexpr long POLL_TIMEOUT_US = 250 * 1000;
+    constexpr long CONNECT_TIMEOUT_US = 1000 * 1000;
+    constexpr auto FIRST_LINE_TIMEOUT = std::chrono::seconds(30);
+
+    void SendAll(StreamSocket& socket, const char* data, size_t size) {
+        while (size > 0) {
+            const int sent = socket.sendBytes(data, static_cast<int>(size));
+            if (sent <= 0) {
+                throw ConnectionResetException();
+            }
+            data += sent;
+            size -= static_cast<size_t>(sent);
+        }
+    }
+}
+
+struct RouterContext {
+    const ServerConfig& Config;
+    AdmissionControl& Admission;
+    std::atomic<u32>& ActiveConnections;
+    std::atomic<bool>& IsStopping;
+    std::atomic<u32>& NextWorker;
+};
+
+class RouterConnectionFilter : public TCPServerConnectionFilter {
+public:
+    explicit RouterConnectionFilter(RouterContext& ctx)
+        : Ctx(ctx)
+    {
+    }
+
+    bool accept(const StreamSocket& socket) override {
+        if (!Ctx.Admission.Admit(socket.peerAddress().host(), AdmissionControl::Kind::PLAYER)) {
+            return false;
+        }
+        const bool accepted = ReserveSlot();
+        Counters().Add(accepted
+                       ? ServerCounter::PLAYER_CONNECTIONS_ACCEPTED
+                       : ServerCounter::PLAYER_CONNECTIONS_REJECTED);
+        return accepted;
+    }
+
+private:
+    RouterContext& Ctx;
+
+private:
+    // The slot is given back when the connection is destroyed
+    bool ReserveSlot() {
+        u32 active = Ctx.ActiveConnections.load();
+        do {
+            if (active >= Ctx.Config.MaxPlayerConnections) {
+                return false;
+            }
+        } while (!Ctx.ActiveConnections.compare_exchange_weak(active, active + 1));
+        return true;
+    }
+};
+
+template <typename S>
+class RouterConnectionFactory final : public TCPServerConnectionFactory {
+public:
+    RouterConnectionFactory(RouterContext& ctx)
+        : TCPServerConnectionFactory()
+        , Ctx(ctx)
+    {
+    }
+
+    TCPServerConnection* createConnection(const StreamSocket& socket) {
+        return new S(socket, Ctx);
+    }
+
+private:
+    RouterContext& Ctx;
+};
+
+class RouterConnection final : public TCPServerConnection {
+public:
+    RouterConnection(const StreamSocket& socket, RouterContext& ctx)
+        : TCPServerConnection(socket)
+        , Ctx(ctx)
+    {
+    }
+
+    ~RouterConnection() {
+        Ctx.ActiveConnections.fetch_sub(1);
+    }
+
+    void run() override {
+        auto& client = socket();
+        try {
+            const auto firstLine = ReadFirstLine(client);
+            if (!firstLine) {
+                return;
+            }
+            auto worker = ConnectToWorker(*firstLine);
+            if (!worker) {
+                const StringView answer = "ERROR No game server is available\n";
+                SendAll(client, answer.data(), answer.size());
+                return;
+            }
+            SendAll(*worker, firstLine->data(), firstLine->size());
+            Relay(client, *worker);
+        } catch (Poco::Net::ConnectionResetException&) {
+            // Either side went away, the other one is closed with us
+        } catch (Poco::Exception& ex) {
+            Log().Error() << "Routed connection closed due to error: " << ex.displayText();
+        }
+    }
+
+private:
+    RouterContext& Ctx;
+    char Buffer[RELAY_BYTES_MAX];
+
+private:
+    // Returns everything received up to and including the first line
+    Maybe<String> ReadFirstLine(StreamSocket& client) {
+        String received;
+        const auto deadline = std::chrono::steady_clock::now() + FIRST_LINE_TIMEOUT;
+        while (received.find('\n') == String::npos) {
+            if (Ctx.IsStopping.load() || std::chrono::steady_clock::now() >= deadline
+                || received.size() > LINE_LENGTH_MAX) {
+                return Nothing<String>();
+            }
+            if (!client.poll(Poco::Timespan(POLL_TIMEOUT_US), Socket::SELECT_READ)) {
+                continue;
+            }
+            const int bytesReceived = client.receiveBytes(Buffer, sizeof(Buffer));
+            if (bytesReceived <= 0) {
+                return Nothing<String>();
+            }
+            received.append(Buffer, static_cast<size_t>(bytesReceived));
+        }
+        return received;
+    }
+
+    Maybe<StreamSocket> ConnectToWorker(StringView firstLine) {
+        const u16 workerCount = Ctx.Config.WorkerCount;
+        const auto words = SplitWords(Strip(firstLine.substr(0, firstLine.find('\n'))));
+        if (words.size() == 2 && words[0] == "WATCH") {
+            if (const auto sessionId = ParseUnsigned(words[1])) {
+                // Only the owner knows the session, no point trying anybody else
+                return TryConnect(WorkerOf(*sessionId, workerCount));
+            }
+        }
+
+        const u32 first = Ctx.NextWorker.fetch_add(1, std::memory_order_relaxed);
+        for (u16 attempt = 0; attempt < workerCount; ++attempt) {
+            if (auto worker = TryConnect(static_cast<u16>((first + attempt) % workerCount))) {
+                return worker;
+            }
+        }
+        return Nothing<StreamSocket>();
+    }
+
+    Maybe<StreamSocket> TryConnect(u16 workerIndex) {
+        try {
+            StreamSocket worker;
+            worker.connect(WorkerAddress(Ctx.Config, workerIndex), Poco::Timespan(CONNECT_TIMEOUT_US));
+            return worker;
+        } catch (Poco::Exception& ex) {
+            Log().Warn() << "Worker " << workerIndex << " is unreachable: " << ex.displayText();
+            return Nothing<StreamSocket>();
+        }
+    }
+
+    void Relay(StreamSocket& client, StreamSocket& worker) {
+        while (!Ctx.IsStopping.load()) {
+            Socket::SocketList readable = {client, worker};
+            Socket::SocketList writable;
+            Socket::SocketList failed;
+            if (Socket::select(readable, writable, failed, Poco::Timespan(POLL_TIMEOUT_US)) == 0) {
+                continue;
+            }
+            for (const auto& ready : readable) {
+                auto& from = ready == client ? client : worker;
+                auto& to = ready == client ? worker : client;
+                const int bytesReceived = from.receiveBytes(Buffer, sizeof(Buffer));
+                if (bytesReceived <= 0) {
+                    return;
+                }
+                SendAll(to, Buffer, static_cast<size_t>(bytesReceived));
+            }
+        }
+    }
+};
+
+class ClusterRouter final : public IClusterRouter {
+public:
+    ClusterRouter(const ServerConfig& config, AdmissionControl& admission)
+        : Ctx({config, admission, ActiveConnections, IsStopping, NextWorker})
+        , RelayThreads("router", 1, std::max<int>(1, config.MaxPlayerConnections))
+        , Server(new RouterConnectionFactory<RouterConnection>(Ctx), RelayThreads, ServerSocket(config.GamePort),
+                 CreateParams(config))
+    {
+        Log().Info() << "Cluster router is listening for players on port " << config.GamePort
+                     << ", routing to " << config.WorkerCount << " workers";
+        Server.setConnectionFilter(new RouterConnectionFilter(Ctx));
+        admission.AddQueueDepthSource([this]() {
+            return static_cast<size_t>(Server.queuedConnections());
+        });
+    }
+
+    ~ClusterRouter() {
+        OnTerminate();
+    }
+
+    void Start() override {
+        Server.start();
+        Log().Info() << "Cluster router started";
+    }
+
+    void OnTerminate() override {
+        IsStopping = true;
+        Server.stop();
+    }
+
+private:
+    std::atomic<u32> ActiveConnections = {0};
+    std::atomic<bool> IsStopping = {false};
+    std::atomic<u32> NextWorker = {0};
+    RouterContext Ctx;
+
+    // Every relayed player holds a thread for the whole connection, Poco's
+    // default pool would stop relaying at 16 whatever the worker count
+    Poco::ThreadPool RelayThreads;
+    TCPServer Server;
+
+private:
+    static TCPServerParams::Ptr CreateParams(const ServerConfig& config) {
+        TCPServerParams::Ptr params = new TCPServerParams();
+        params->setMaxThreads(config.MaxPlayerConnections);
+        params->setMaxQueued(config.MaxPlayerConnections);
+        return params;
+    }
+};
+
+Holder<IClusterRouter> IClusterRouter::Create(const ServerConfig& config, AdmissionControl& admission) {
+    return MakeHolder<ClusterRouter>(config, admission);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "admission_control.h"
+#include "player_connection_manager.h"
+#include "server_config.h"
+#include "util/holder.h"
+
+// Player-facing side of a cluster router. Every connection is pinned to one
+// worker chosen from its first line: WATCH goes to the worker owning the
+// session, everything else is spread round-robin over the live workers.
+// After that bytes are relayed both ways untouched.
+//
+// Per-address rate limits are applied here, where the players' addresses
+// are known. Shedding on overload is left to every worker, which sees its
+// own move latency, the router only sheds on its own accept queue.
+class IClusterRouter : public IPlayerConnectionManager {
+public:
+    static Holder<IClusterRouter> Create(const ServerConfig& config, AdmissionControl& admission);
+};
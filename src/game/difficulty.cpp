@@ -0,0 +1,56 @@
+#include "difficulty.h"
+
+namespace {
+    struct Preset {
+        Difficulty Level;
+        StringView Name;
+        u8 Width;
+        u8 Height;
+        u32 MineCount;
+    };
+
+    constexpr Preset PRESETS[] = {
+        {Difficulty::BEGINNER, "beginner", 9, 9, 10},
+        {Difficulty::INTERMEDIATE, "intermediate", 16, 16, 40},
+        {Difficulty::EXPERT, "expert", 30, 16, 99},
+    };
+}
+
+StringView ToString(Difficulty difficulty) {
+    for (const auto& preset : PRESETS) {
+        if (preset.Level == difficulty) {
+            return preset.Name;
+        }
+    }
+    return "custom";
+}
+
+Maybe<Difficulty> ParseDifficulty(StringView name) {
+    for (const auto& preset : PRESETS) {
+        if (preset.Name == name) {
+            return preset.Level;
+        }
+    }
+    if (name == "custom") {
+        return Difficulty::CUSTOM;
+    }
+    return Nothing<Difficulty>();
+}
+
+Difficulty ClassifyDifficulty(u8 width, u8 height, u32 mineCount) {
+    for (const auto& preset : PRESETS) {
+        if (preset.Width == width && preset.Height == height && preset.MineCount == mineCount) {
+            return preset.Level;
+        }
+    }
+    return Difficulty::CUSTOM;
+}
+
+Maybe<BoardParameters> PresetBoard(Difficulty difficulty) {
+    for (const auto& preset : PRESETS) {
+        if (preset.Level == difficulty) {
+            return BoardParameters{preset.Width, preset.Height, preset.MineCount};
+        }
+    }
+    return Nothing<BoardParameters>();
+}
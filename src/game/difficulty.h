@@ -0,0 +1,32 @@
+#pragma once
+
+#include "../types.h"
+#include "../util/maybe.h"
+#include "../util/string.h"
+
+enum class Difficulty : u8 {
+    BEGINNER,
+    INTERMEDIATE,
+    EXPERT,
+    CUSTOM,
+    COUNT
+};
+
+// Custom boards are playable but never ranked
+constexpr size_t RANKED_DIFFICULTY_COUNT = static_cast<size_t>(Difficulty::CUSTOM);
+
+struct BoardParameters {
+    u8 Width = 0;
+    u8 Height = 0;
+    u32 MineCount = 0;
+};
+
+StringView ToString(Difficulty difficulty);
+Maybe<Difficulty> ParseDifficulty(StringView name);
+Difficulty ClassifyDifficulty(u8 width, u8 height, u32 mineCount);
+// Custom boards have no preset
+Maybe<BoardParameters> PresetBoard(Difficulty difficulty);
+
+inline bool IsRanked(Difficulty difficulty) {
+    return static_cast<size_t>(difficulty) < RANKED_DIFFICULTY_COUNT;
+}
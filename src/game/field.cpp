@@ -1,6 +1,6 @@
 #include "field.h"
 
-#include "../util/client_error.h"
+#include "../util/latency.h"
 #include "../util/string.h"
 
 #include <algorithm>
@@ -8,48 +8,60 @@
 #include <numeric>
 #include <queue>
 #include <random>
+#include <stdexcept>
 
-size_t ToIndexUnsafe(u8 width, u8 x, u8 y) {
-    return size_t(y) * width + x;
-}
-
-bool VerifyDimension(u8 dimension) {
-    return dimension < 9 || dimension > 30;
-}
-
-u8 VerifyWidth(u8 width) {
-    if (!VerifyDimension(width)) {
-        throw ClientError("Width should be between 9 and 30");
+Field::Field(u8 width, u8 height, u32 mineCount, u32 seed)
+    : Width(width)
+    , Height(height)
+    , MineCount(mineCount)
+    , Seed(seed)
+    , Cells(u32(Width) * Height)
+    , OpenCount(0)
+    , IsUntouched(true)
+{
+    const auto error = CheckParameters(width, height, mineCount);
+    if (error != Error::NONE) {
+        throw std::invalid_argument(String(Describe(error)));
     }
-    return width;
 }
 
-u8 VerifyHeight(u8 height) {
-    if (!VerifyDimension(height)) {
-        throw ClientError("Height should be between 9 and 30");
+Field::Error Field::CheckParameters(u8 width, u8 height, u32 mineCount) {
+    constexpr u8 DIMENSION_MIN = 9;
+    constexpr u8 DIMENSION_MAX = 30;
+    if (width < DIMENSION_MIN || width > DIMENSION_MAX) {
+        return Error::WRONG_WIDTH;
     }
-    return height;
+    if (height < DIMENSION_MIN || height > DIMENSION_MAX) {
+        return Error::WRONG_HEIGHT;
+    }
+    if (mineCount == 0 || mineCount >= u32(width) * height - 1) {
+        return Error::WRONG_MINE_COUNT;
+    }
+    return Error::NONE;
 }
 
-u32 VerifyMineCount(u32 area, u32 mineCount) {
-    if (mineCount == 0 || mineCount + 1 >= area) {
-        throw ClientError(String{"Wrong amount of mines: "} + std::to_string(mineCount));
-    }
-    return mineCount;
+Field::OpenCellResult Field::RejectOpen(Error reason) {
+    return {ActionType::REJECTED, {}, reason};
 }
 
-Field::Field(u8 width, u8 height, u32 mineCount, u32 seed)
-    : Width(VerifyWidth(width))
-    , Height(VerifyHeight(height))
-    , MineCount(VerifyMineCount(u32(Width) * Height, mineCount))
-    , Seed(seed)
-    , Cells(u32(Width) * Height)
-    , IsUntouched(true)
-{
+Field::PlaceFlagResult Field::RejectFlag(Error reason) {
+    return {ActionType::REJECTED, reason};
 }
 
 Field::OpenCellResult Field::OpenCell(u8 x, u8 y) {
+    LATENCY_SCOPE(LatencyProbe::FIELD_OPEN_CELL);
+    if (!Contains(x, y)) {
+        return RejectOpen(Error::OUT_OF_BOUNDS);
+    }
     auto& cell = Get(x, y);
+    if (cell.IsOpen) {
+        return {Field::ActionType::CELL_IS_ALREADY_OPEN};
+    }
+
+    if (cell.HasFlag) {
+        return {Field::ActionType::CELL_HAS_FLAG};
+    }
+
     if (IsUntouched) {
         GenerateMines(x, y);
         IsUntouched = false;
@@ -59,18 +71,13 @@ Field::OpenCellResult Field::OpenCell(u8 x, u8 y) {
         return {Field::ActionType::EXPLODE};
     }
 
-    if (cell.IsOpen) {
-        return {Field::ActionType::CELL_IS_ALREADY_OPEN};
-    }
-
-    if (cell.HasFlag) {
-        return {Field::ActionType::CELL_HAS_FLAG};
-    }
-
     return {Field::ActionType::NEW_CELLS_OPEN, OpenNewCells(x, y)};
 }
 
 Field::PlaceFlagResult Field::PlaceFlag(u8 x, u8 y) {
+    if (!Contains(x, y)) {
+        return RejectFlag(Error::OUT_OF_BOUNDS);
+    }
     auto& cell = Get(x, y);
     if (cell.IsOpen) {
         return {Field::ActionType::CELL_IS_ALREADY_OPEN};
@@ -83,72 +90,96 @@ Field::PlaceFlagResult Field::PlaceFlag(u8 x, u8 y) {
             : Field::ActionType::FLAG_REMOVED};
 }
 
-size_t Field::ToIndex(u8 x, u8 y) const {
-    size_t idx = size_t(y) * Width + x;
-    if (idx >= Cells.size()) {
-        throw ClientError("Wrong cell indices: "
-                          + std::to_string(x) + ", "
-                          + std::to_string(y));
+bool Field::IsCleared() const {
+    return OpenCount + MineCount == Cells.size();
+}
+
+bool Field::Contains(u8 x, u8 y) const {
+    return x < Width && y < Height;
+}
+
+u8 Field::GetWidth() const {
+    return Width;
+}
+
+u8 Field::GetHeight() const {
+    return Height;
+}
+
+Field::CellView Field::View(u8 x, u8 y) const {
+    const auto& cell = Cells[ToIndex(x, y)];
+    return {cell.IsOpen, cell.HasFlag, cell.IsOpen ? cell.MinesAround : u8(0)};
+}
+
+Field::Snapshot Field::TakeSnapshot() const {
+    constexpr size_t BITS_PER_WORD = 64;
+    const size_t words = (Cells.size() + BITS_PER_WORD - 1) / BITS_PER_WORD;
+
+    Field::Snapshot snapshot;
+    snapshot.Width = Width;
+    snapshot.Height = Height;
+    snapshot.OpenMask.resize(words);
+    snapshot.FlagMask.resize(words);
+    snapshot.MinesAround.resize(Cells.size());
+    for (size_t i = 0; i < Cells.size(); ++i) {
+        const u64 bit = u64(1) << (i % BITS_PER_WORD);
+        if (Cells[i].IsOpen) {
+            snapshot.OpenMask[i / BITS_PER_WORD] |= bit;
+            snapshot.MinesAround[i] = Cells[i].MinesAround;
+        }
+        if (Cells[i].HasFlag) {
+            snapshot.FlagMask[i / BITS_PER_WORD] |= bit;
+        }
     }
-    return idx;
+    return snapshot;
 }
 
-Field::Cell& Field::Get(u8 x, u8 y) {
-    return Cells[ToIndex(x, y)];
+// Callers check Contains first
+size_t Field::ToIndex(u8 x, u8 y) const {
+    return size_t(y) * Width + x;
 }
 
-Field::Cell& Field::GetUnsafe(u8 x, u8 y) {
-    return Cells[ToIndexUnsafe(Width, x, y)];
+Field::Cell& Field::Get(u8 x, u8 y) {
+    return Cells[ToIndex(x, y)];
 }
 
 std::vector<Field::NewOpenCell> Field::OpenNewCells(u8 x, u8 y) {
+    LATENCY_SCOPE(LatencyProbe::FIELD_OPEN_NEW_CELLS);
     // Let's do some BFS!
     std::vector<Field::NewOpenCell> result;
     std::queue<Field::NewOpenCell> toOpen;
 
-    toOpen.push({x, y});
-    while (!toOpen.empty()) {
-        const auto& coords = toOpen.front();
-        auto& cell = GetUnsafe(coords.X, coords.Y);
-        result.push_back(coords);
+    const auto open = [this, &toOpen](u8 cellX, u8 cellY) {
+        auto& cell = Get(cellX, cellY);
         cell.IsOpen = true;
+        ++OpenCount;
+        toOpen.push({cellX, cellY, cell.MinesAround});
+    };
 
-        // BEWARE: CRAPCODE!
-        if (coords.X > 0) {
-            auto& candidate = GetUnsafe(coords.X, coords.Y);
-            if (!candidate.IsOpen && !candidate.HasMine) {
-                toOpen.push({u8(coords.X - 1), coords.Y});
-            }
-        }
-        if (coords.X + 1 < Width) {
-            auto& candidate = GetUnsafe(coords.X, coords.Y);
-            if (!candidate.IsOpen && !candidate.HasMine) {
-                toOpen.push({u8(coords.X + 1), coords.Y});
-            }
-        }
-        if (coords.Y > 0) {
-            auto& candidate = GetUnsafe(coords.X, coords.Y);
-            if (!candidate.IsOpen && !candidate.HasMine) {
-                toOpen.push({coords.X, u8(coords.Y - 1)});
-            }
-        }
-        if (coords.Y + 1 < Height) {
-            auto& candidate = GetUnsafe(coords.X, coords.Y);
-            if (!candidate.IsOpen && !candidate.HasMine) {
-                toOpen.push({coords.X, u8(coords.Y + 1)});
-            }
+    open(x, y);
+    while (!toOpen.empty()) {
+        const auto coords = toOpen.front();
+        toOpen.pop();
+        result.push_back(coords);
+        if (coords.MinesAround != 0) {
+            continue;
         }
 
-        toOpen.pop();
+        ForEachNeighbour(coords.X, coords.Y, [this, &open](u8 neighbourX, u8 neighbourY) {
+            const auto& candidate = Get(neighbourX, neighbourY);
+            if (!candidate.IsOpen && !candidate.HasMine && !candidate.HasFlag) {
+                open(neighbourX, neighbourY);
+            }
+        });
     }
 
     return result;
 }
 
 void Field::GenerateMines(u8 x, u8 y) {
+    LATENCY_SCOPE(LatencyProbe::FIELD_GENERATE_MINES);
     const size_t origin = ToIndex(x, y);
-    const size_t area = size_t(x) * y;
-    std::vector<size_t> possibleIndices(area);
+    std::vector<size_t> possibleIndices(Cells.size());
 
     std::iota(possibleIndices.begin(), possibleIndices.end(), 0);
     std::swap(possibleIndices[origin], possibleIndices.back());
@@ -161,5 +192,20 @@ void Field::GenerateMines(u8 x, u8 y) {
 
     for (const auto idx : mineIndices) {
         Cells[idx].HasMine = true;
+        ForEachNeighbour(u8(idx % Width), u8(idx / Width), [this](u8 neighbourX, u8 neighbourY) {
+            ++Get(neighbourX, neighbourY).MinesAround;
+        });
+    }
+}
+
+StringView Describe(Field::Error error) {
+    switch (error) {
+        case Field::Error::NONE: return "No error";
+        case Field::Error::WRONG_WIDTH: return "Width should be between 9 and 30";
+        case Field::Error::WRONG_HEIGHT: return "Height should be between 9 and 30";
+        case Field::Error::WRONG_MINE_COUNT: return "Wrong amount of mines";
+        case Field::Error::OUT_OF_BOUNDS: return "Cell is outside of the field";
+        case Field::Error::GAME_IS_OVER: return "Game is over";
     }
+    return "Unknown error";
 }
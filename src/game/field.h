@@ -1,7 +1,9 @@
 #pragma once
 
 #include "../types.h"
+#include "../util/string.h"
 
+#include <cstddef>
 #include <vector>
 
 class Field {
@@ -12,29 +14,73 @@ public:
         CELL_IS_ALREADY_OPEN,
         CELL_HAS_FLAG,
         FLAG_PLACED,
-        FLAG_REMOVED
+        FLAG_REMOVED,
+        // The move was not applied, see Error
+        REJECTED
+    };
+
+    // Kept to a byte so a bad move costs no more than a good one, messages
+    // are only looked up when an answer is written
+    enum class Error : u8 {
+        NONE,
+        WRONG_WIDTH,
+        WRONG_HEIGHT,
+        WRONG_MINE_COUNT,
+        OUT_OF_BOUNDS,
+        GAME_IS_OVER
     };
 
     struct NewOpenCell {
         const u8 X = 0;
         const u8 Y = 0;
+        const u8 MinesAround = 0;
     };
 
     struct OpenCellResult {
         const ActionType Type;
         const std::vector<NewOpenCell> NewOpenCells = {};
+        const Error Reason = Error::NONE;
     };
 
     struct PlaceFlagResult {
         const ActionType Type = ActionType::CELL_HAS_FLAG;
+        const Error Reason = Error::NONE;
+    };
+
+    struct CellView {
+        bool IsOpen = false;
+        bool HasFlag = false;
+        u8 MinesAround = 0;
+    };
+
+    // One bit per cell in row-major order, MinesAround is filled for open cells only
+    struct Snapshot {
+        u8 Width = 0;
+        u8 Height = 0;
+        std::vector<u64> OpenMask;
+        std::vector<u64> FlagMask;
+        std::vector<u8> MinesAround;
     };
 
 public:
+    // Parameters must pass CheckParameters first
     Field(u8 width, u8 height, u32 mineCount, u32 seed);
 
+    static Error CheckParameters(u8 width, u8 height, u32 mineCount);
+    static OpenCellResult RejectOpen(Error reason);
+    static PlaceFlagResult RejectFlag(Error reason);
+
     OpenCellResult OpenCell(u8 x, u8 y);
     PlaceFlagResult PlaceFlag(u8 x, u8 y);
 
+    bool IsCleared() const;
+    bool Contains(u8 x, u8 y) const;
+
+    u8 GetWidth() const;
+    u8 GetHeight() const;
+    CellView View(u8 x, u8 y) const;
+    Snapshot TakeSnapshot() const;
+
 public:
     Field(const Field&) = delete;
     Field& operator=(const Field&) = delete;
@@ -44,6 +90,7 @@ private:
         bool HasMine = false;
         bool IsOpen = false;
         bool HasFlag = false;
+        u8 MinesAround = 0;
     };
 
 private:
@@ -52,12 +99,29 @@ private:
     u32 MineCount;
     u32 Seed;
     std::vector<Cell> Cells;
+    size_t OpenCount;
     bool IsUntouched;
 
 private:
     size_t ToIndex(u8 x, u8 y) const;
     Cell& Get(u8 x, u8 y);
-    Cell& GetUnsafe(u8 x, u8 y);
     std::vector<NewOpenCell> OpenNewCells(u8 x, u8 y);
     void GenerateMines(u8 x, u8 y);
+
+    template <typename F>
+    void ForEachNeighbour(u8 x, u8 y, F&& callback) const {
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) {
+                const int neighbourX = x + dx;
+                const int neighbourY = y + dy;
+                if ((dx != 0 || dy != 0)
+                    && neighbourX >= 0 && neighbourX < Width
+                    && neighbourY >= 0 && neighbourY < Height) {
+                    callback(u8(neighbourX), u8(neighbourY));
+                }
+            }
+        }
+    }
 };
+
+StringView Describe(Field::Error error);
@@ -0,0 +1,132 @@
+#include "game_session.h"
+
+GameSession::GameSession(const Context& ctx, u64 id, u32 seed, IGameCompletionListener& listener)
+    : Id(id)
+    , Level(ClassifyDifficulty(ctx.FieldWidth, ctx.FieldHeight, ctx.MineCount))
+    , CompletionListener(listener)
+    , GameField(ctx.FieldWidth, ctx.FieldHeight, ctx.MineCount, seed)
+    , PlayerCount(0)
+    , GameIsRunning(true)
+    , IsDirty(size_t(ctx.FieldWidth) * ctx.FieldHeight)
+{
+}
+
+bool GameSession::OnDisconnect() {
+    std::lock_guard<std::mutex> lock(Mutex);
+    if (PlayerCount > 0) {
+        --PlayerCount;
+    }
+    return PlayerCount == 0;
+}
+
+void GameSession::OnConnect(u32 players) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    PlayerCount += players;
+}
+
+GameSession::OpenCellOutcome GameSession::OpenCell(u8 x, u8 y, const String& player) {
+    std::unique_lock<std::mutex> lock(Mutex);
+    if (!GameIsRunning) {
+        return {Field::RejectOpen(Field::Error::GAME_IS_OVER)};
+    }
+    if (!GameField.Contains(x, y)) {
+        return {Field::RejectOpen(Field::Error::OUT_OF_BOUNDS)};
+    }
+    if (!StartedAt) {
+        StartedAt = Clock::now();
+    }
+
+    auto result = GameField.OpenCell(x, y);
+    Maybe<GameCompletion> completion;
+    for (const auto& cell : result.NewOpenCells) {
+        MarkDirty(cell.X, cell.Y);
+    }
+    if (result.Type == Field::ActionType::EXPLODE) {
+        Explosion = SpectatorCell{x, y, 'X'};
+        MarkDirty(x, y);
+        completion = Complete(false, player);
+    } else if (GameField.IsCleared()) {
+        completion = Complete(true, player);
+    }
+    lock.unlock();
+
+    if (completion) {
+        CompletionListener.OnGameCompleted(*completion);
+    }
+    return {std::move(result), std::move(completion)};
+}
+
+Field::PlaceFlagResult GameSession::PlaceFlag(u8 x, u8 y) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    if (!GameIsRunning) {
+        return Field::RejectFlag(Field::Error::GAME_IS_OVER);
+    }
+    auto result = GameField.PlaceFlag(x, y);
+    if (result.Type == Field::ActionType::FLAG_PLACED || result.Type == Field::ActionType::FLAG_REMOVED) {
+        MarkDirty(x, y);
+    }
+    return result;
+}
+
+u64 GameSession::GetId() const {
+    return Id;
+}
+
+Difficulty GameSession::GetDifficulty() const {
+    return Level;
+}
+
+void GameSession::SetWatched(bool watched) {
+    IsWatched.store(watched, std::memory_order_relaxed);
+}
+
+GameSession::SpectatorUpdate GameSession::CollectSpectatorUpdate() {
+    std::lock_guard<std::mutex> lock(Mutex);
+    SpectatorUpdate update;
+    update.GameStatus = GetStatus();
+    update.Cells.reserve(DirtyCells.size());
+    const u8 width = GameField.GetWidth();
+    for (const auto index : DirtyCells) {
+        IsDirty[index] = false;
+        const u8 x = u8(index % width);
+        const u8 y = u8(index / width);
+        if (Explosion && Explosion->X == x && Explosion->Y == y) {
+            update.Cells.push_back(*Explosion);
+            continue;
+        }
+        const auto view = GameField.View(x, y);
+        const char state = view.IsOpen ? char('0' + view.MinesAround) : (view.HasFlag ? 'F' : 'H');
+        update.Cells.push_back({x, y, state});
+    }
+    DirtyCells.clear();
+    return update;
+}
+
+GameSession::SpectatorSnapshot GameSession::TakeSpectatorSnapshot() {
+    std::lock_guard<std::mutex> lock(Mutex);
+    return {GameField.TakeSnapshot(), Explosion, GetStatus()};
+}
+
+GameSession::Status GameSession::GetStatus() const {
+    if (GameIsRunning) {
+        return Status::RUNNING;
+    }
+    return Explosion ? Status::LOST : Status::WON;
+}
+
+void GameSession::MarkDirty(u8 x, u8 y) {
+    if (!IsWatched.load(std::memory_order_relaxed)) {
+        return;
+    }
+    const size_t index = size_t(y) * GameField.GetWidth() + x;
+    if (!IsDirty[index]) {
+        IsDirty[index] = true;
+        DirtyCells.push_back(static_cast<u16>(index));
+    }
+}
+
+GameCompletion GameSession::Complete(bool won, const String& player) {
+    GameIsRunning = false;
+    const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - *StartedAt);
+    return {Level, static_cast<u32>(duration.count()), won, player};
+}
@@ -1,9 +1,29 @@
 #pragma once
 
 #include "../types.h"
+#include "../util/maybe.h"
+#include "../util/string.h"
+#include "difficulty.h"
 #include "field.h"
 
+#include <atomic>
+#include <chrono>
 #include <mutex>
+#include <vector>
+
+struct GameCompletion {
+    Difficulty Level = Difficulty::CUSTOM;
+    u32 DurationMs = 0;
+    bool Won = false;
+    String Player;
+};
+
+class IGameCompletionListener {
+public:
+    virtual ~IGameCompletionListener() = default;
+
+    virtual void OnGameCompleted(const GameCompletion& completion) = 0;
+};
 
 class GameSession {
 public:
@@ -13,19 +33,80 @@ public:
         u8 FieldHeight = 10;
     };
 
+    struct OpenCellOutcome {
+        const Field::OpenCellResult Result;
+        const Maybe<GameCompletion> Completion = {};
+    };
+
+    enum class Status : u8 {
+        RUNNING,
+        WON,
+        LOST
+    };
+
+    // State of a cell as seen by spectators: '0'..'8' open, 'F' flagged,
+    // 'H' hidden (flag removed) or 'X' for the mine that exploded
+    struct SpectatorCell {
+        u8 X = 0;
+        u8 Y = 0;
+        char State = 'H';
+    };
+
+    struct SpectatorUpdate {
+        std::vector<SpectatorCell> Cells;
+        Status GameStatus = Status::RUNNING;
+    };
+
+    struct SpectatorSnapshot {
+        Field::Snapshot Board;
+        Maybe<SpectatorCell> Explosion;
+        Status GameStatus = Status::RUNNING;
+    };
+
 public:
-    explicit GameSession(const Context& ctx);
+    GameSession(const Context& ctx, u64 id, u32 seed, IGameCompletionListener& listener);
+
+    // Returns true when the last player has left
+    bool OnDisconnect();
+    // A matched session counts its whole group up front, so it can't be
+    // removed before every player had the chance to pick it up
+    void OnConnect(u32 players = 1);
+
+    OpenCellOutcome OpenCell(u8 x, u8 y, const String& player);
+    Field::PlaceFlagResult PlaceFlag(u8 x, u8 y);
 
-    void OnDisconnect();
-    void OnConnect();
+    u64 GetId() const;
+    Difficulty GetDifficulty() const;
+
+    // Changed cells are only tracked while somebody is watching
+    void SetWatched(bool watched);
+    SpectatorUpdate CollectSpectatorUpdate();
+    SpectatorSnapshot TakeSpectatorSnapshot();
 
 public:
     GameSession(const GameSession&) = delete;
     GameSession& operator=(const GameSession&) = delete;
 
+private:
+    using Clock = std::chrono::steady_clock;
+
 private:
     std::mutex Mutex;
+    const u64 Id;
+    const Difficulty Level;
+    IGameCompletionListener& CompletionListener;
     Field GameField;
-    u8 PlayerCount;
+    Maybe<Clock::time_point> StartedAt;
+    u32 PlayerCount;
     bool GameIsRunning;
+    Maybe<SpectatorCell> Explosion;
+
+    std::atomic<bool> IsWatched = {false};
+    std::vector<bool> IsDirty;
+    std::vector<u16> DirtyCells;
+
+private:
+    GameCompletion Complete(bool won, const String& player);
+    Status GetStatus() const;
+    void MarkDirty(u8 x, u8 y);
 };
@@ -0,0 +1,239 @@
+#include "leaderboard.h"
+
+#include "../util/log.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+    constexpr auto SNAPSHOT_HEADER = "minesweeper-leaderboard 1";
+
+    size_t LowestBit(size_t value) {
+        return value & (~value + 1);
+    }
+}
+
+CompletionTimeTree::CompletionTimeTree()
+    : Tree(BUCKET_COUNT + 1)
+{
+}
+
+size_t CompletionTimeTree::ToBucket(u32 durationMs) noexcept {
+    return std::min<size_t>(durationMs / BUCKET_WIDTH_MS, BUCKET_COUNT - 1);
+}
+
+void CompletionTimeTree::Add(size_t bucket, u64 count) noexcept {
+    for (size_t i = bucket + 1; i < Tree.size(); i += LowestBit(i)) {
+        Tree[i].fetch_add(count, std::memory_order_relaxed);
+    }
+    Count.fetch_add(count, std::memory_order_relaxed);
+}
+
+u64 CompletionTimeTree::CountBelow(size_t bucket) const noexcept {
+    u64 result = 0;
+    for (size_t i = bucket; i > 0; i -= LowestBit(i)) {
+        result += Tree[i].load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+u64 CompletionTimeTree::Total() const noexcept {
+    return Count.load(std::memory_order_relaxed);
+}
+
+void Leaderboard::Board::Submit(u32 durationMs, const String& player) {
+    Times.Add(CompletionTimeTree::ToBucket(durationMs), 1);
+    if (durationMs < TopThreshold.load(std::memory_order_relaxed)) {
+        InsertTop(durationMs, player);
+    }
+}
+
+void Leaderboard::Board::InsertTop(u32 durationMs, const String& player) {
+    std::lock_guard<std::mutex> lock(TopMutex);
+    const auto position = std::upper_bound(TopEntries.begin(), TopEntries.end(), durationMs,
+                                           [](u32 duration, const Entry& entry) {
+                                               return duration < entry.DurationMs;
+                                           });
+    if (position == TopEntries.end() && TopEntries.size() >= TOP_SIZE) {
+        return;
+    }
+
+    TopEntries.insert(position, {durationMs, player});
+    if (TopEntries.size() > TOP_SIZE) {
+        TopEntries.pop_back();
+    }
+    if (TopEntries.size() == TOP_SIZE) {
+        TopThreshold.store(TopEntries.back().DurationMs, std::memory_order_relaxed);
+    }
+}
+
+Leaderboard::Leaderboard(const Maybe<String>& snapshotPath, std::chrono::seconds snapshotInterval)
+    : SnapshotPath(snapshotPath)
+    , SnapshotInterval(snapshotInterval)
+{
+    for (auto& board : Boards) {
+        board = MakeHolder<Board>();
+    }
+    Load();
+}
+
+Leaderboard::~Leaderboard() {
+    if (Snapshotter.joinable()) {
+        OnTerminate();
+    }
+}
+
+void Leaderboard::Start() {
+    if (!SnapshotPath) {
+        return;
+    }
+    Snapshotter = std::thread([this]() { RunSnapshots(); });
+    Log().Info() << "Leaderboard snapshots are written to " << *SnapshotPath
+                 << " every " << SnapshotInterval.count() << "s";
+}
+
+void Leaderboard::OnGameCompleted(const GameCompletion& completion) {
+    if (!completion.Won || !IsRanked(completion.Level)) {
+        return;
+    }
+    Boards[static_cast<size_t>(completion.Level)]->Submit(completion.DurationMs, completion.Player);
+}
+
+void Leaderboard::OnTerminate() {
+    {
+        std::lock_guard<std::mutex> lock(SnapshotMutex);
+        ShouldStop = true;
+        SnapshotCv.notify_all();
+    }
+    if (Snapshotter.joinable()) {
+        Snapshotter.join();
+        Save();
+    }
+}
+
+u64 Leaderboard::Rank(Difficulty level, u32 durationMs) const noexcept {
+    const auto* board = Find(level);
+    if (!board) {
+        return 0;
+    }
+    return board->Times.CountBelow(CompletionTimeTree::ToBucket(durationMs)) + 1;
+}
+
+u64 Leaderboard::Size(Difficulty level) const noexcept {
+    const auto* board = Find(level);
+    return board ? board->Times.Total() : 0;
+}
+
+std::vector<Leaderboard::Entry> Leaderboard::Top(Difficulty level, size_t count) const {
+    const auto* board = Find(level);
+    if (!board) {
+        return {};
+    }
+    std::lock_guard<std::mutex> lock(board->TopMutex);
+    const auto end = board->TopEntries.begin() + std::min(count, board->TopEntries.size());
+    return {board->TopEntries.begin(), end};
+}
+
+const Leaderboard::Board* Leaderboard::Find(Difficulty level) const noexcept {
+    if (!IsRanked(level)) {
+        return nullptr;
+    }
+    return Boards[static_cast<size_t>(level)].get();
+}
+
+void Leaderboard::RunSnapshots() {
+    std::unique_lock<std::mutex> lock(SnapshotMutex);
+    while (!SnapshotCv.wait_for(lock, SnapshotInterval, [this]() { return ShouldStop; })) {
+        lock.unlock();
+        Save();
+        lock.lock();
+    }
+}
+
+// The snapshot is a plain text file:
+//   minesweeper-leaderboard 1
+//   board <difficulty> <non-empty bucket count> <top entry count>
+//   <bucket> <count>          (one line per non-empty bucket)
+//   <duration ms> <player>    (one line per top entry)
+void Leaderboard::Save() const {
+    const String temporaryPath = *SnapshotPath + ".tmp";
+    try {
+        std::ofstream out(temporaryPath, std::ios::trunc);
+        out << SNAPSHOT_HEADER << '\n';
+        for (size_t i = 0; i < Boards.size(); ++i) {
+            const auto& board = *Boards[i];
+            std::vector<std::pair<size_t, u64>> buckets;
+            u64 previous = 0;
+            for (size_t bucket = 0; bucket < CompletionTimeTree::BUCKET_COUNT; ++bucket) {
+                const u64 below = board.Times.CountBelow(bucket + 1);
+                if (below > previous) {
+                    buckets.emplace_back(bucket, below - previous);
+                }
+                previous = below;
+            }
+            const auto top = Top(static_cast<Difficulty>(i), TOP_SIZE);
+
+            out << "board " << ToString(static_cast<Difficulty>(i)) << ' '
+                << buckets.size() << ' ' << top.size() << '\n';
+            for (const auto& [bucket, count] : buckets) {
+                out << bucket << ' ' << count << '\n';
+            }
+            for (const auto& entry : top) {
+                out << entry.DurationMs << ' ' << entry.Player << '\n';
+            }
+        }
+        out.close();
+        if (!out) {
+            Log().Error() << "Cannot write leaderboard snapshot to " << temporaryPath;
+            return;
+        }
+        std::filesystem::rename(temporaryPath, *SnapshotPath);
+    } catch (const std::exception& e) {
+        Log().Error() << "Cannot save leaderboard snapshot: " << e.what();
+    }
+}
+
+void Leaderboard::Load() {
+    if (!SnapshotPath) {
+        return;
+    }
+    std::ifstream in(*SnapshotPath);
+    if (!in.is_open()) {
+        Log().Info() << "No leaderboard snapshot at " << *SnapshotPath << ", starting empty";
+        return;
+    }
+
+    String header;
+    std::getline(in, header);
+    if (header != SNAPSHOT_HEADER) {
+        Log().Error() << "Unknown leaderboard snapshot format in " << *SnapshotPath;
+        return;
+    }
+
+    String tag;
+    String name;
+    size_t bucketCount = 0;
+    size_t topCount = 0;
+    while (in >> tag >> name >> bucketCount >> topCount) {
+        const auto level = ParseDifficulty(name);
+        if (tag != "board" || !level || !IsRanked(*level)) {
+            Log().Error() << "Corrupted leaderboard snapshot in " << *SnapshotPath;
+            return;
+        }
+        auto& board = *Boards[static_cast<size_t>(*level)];
+        for (size_t i = 0; i < bucketCount; ++i) {
+            size_t bucket = 0;
+            u64 count = 0;
+            in >> bucket >> count;
+            board.Times.Add(std::min(bucket, CompletionTimeTree::BUCKET_COUNT - 1), count);
+        }
+        for (size_t i = 0; i < topCount; ++i) {
+            u32 durationMs = 0;
+            String player;
+            in >> durationMs >> player;
+            board.InsertTop(durationMs, player);
+        }
+    }
+    Log().Info() << "Leaderboard restored from " << *SnapshotPath;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "../termination.h"
+#include "../types.h"
+#include "../util/holder.h"
+#include "../util/maybe.h"
+#include "../util/string.h"
+#include "difficulty.h"
+#include "game_session.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Completion times are counted in fixed-width buckets kept in a Fenwick tree
+// of atomics, so both a new result and a rank query touch O(log buckets)
+// counters and never take a lock. Only results good enough for the top list
+// take the (per difficulty) top list mutex.
+class CompletionTimeTree {
+public:
+    static constexpr u32 BUCKET_WIDTH_MS = 10;
+    static constexpr size_t BUCKET_COUNT = size_t(1) << 17;
+
+    CompletionTimeTree();
+
+    static size_t ToBucket(u32 durationMs) noexcept;
+
+    void Add(size_t bucket, u64 count) noexcept;
+    u64 CountBelow(size_t bucket) const noexcept;
+    u64 Total() const noexcept;
+
+public:
+    CompletionTimeTree(const CompletionTimeTree&) = delete;
+    CompletionTimeTree& operator=(const CompletionTimeTree&) = delete;
+
+private:
+    std::vector<std::atomic<u64>> Tree;
+    std::atomic<u64> Count = {0};
+};
+
+class Leaderboard final : public IGameCompletionListener, public ITerminationListener {
+public:
+    struct Entry {
+        u32 DurationMs = 0;
+        String Player;
+    };
+
+    static constexpr size_t TOP_SIZE = 100;
+
+public:
+    Leaderboard(const Maybe<String>& snapshotPath, std::chrono::seconds snapshotInterval);
+    ~Leaderboard();
+
+    void Start();
+
+    void OnGameCompleted(const GameCompletion& completion) override;
+    void OnTerminate() override;
+
+    // 1-based rank a result of durationMs has (or would have) among all results
+    u64 Rank(Difficulty level, u32 durationMs) const noexcept;
+    u64 Size(Difficulty level) const noexcept;
+    std::vector<Entry> Top(Difficulty level, size_t count) const;
+
+public:
+    Leaderboard(const Leaderboard&) = delete;
+    Leaderboard& operator=(const Leaderboard&) = delete;
+
+private:
+    struct Board {
+        CompletionTimeTree Times;
+        mutable std::mutex TopMutex;
+        std::vector<Entry> TopEntries;
+        std::atomic<u32> TopThreshold = {UINT32_MAX};
+
+        void Submit(u32 durationMs, const String& player);
+        void InsertTop(u32 durationMs, const String& player);
+    };
+
+private:
+    const Maybe<String> SnapshotPath;
+    const std::chrono::seconds SnapshotInterval;
+    std::array<Holder<Board>, RANKED_DIFFICULTY_COUNT> Boards;
+
+    std::mutex SnapshotMutex;
+    std::condition_variable SnapshotCv;
+    bool ShouldStop = false;
+    std::thread Snapshotter;
+
+private:
+    const Board* Find(Difficulty level) const noexcept;
+    void RunSnapshots();
+    void Save() const;
+    void Load();
+};
@@ -0,0 +1,171 @@
+#include "matchmaker.h"
+
+#include "../util/counters.h"
+#include "../util/latency.h"
+#include "../util/log.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+    constexpr auto MATCH_INTERVAL = std::chrono::milliseconds(20);
+
+    constexpr ServerGauge QUEUED_GAUGES[RANKED_DIFFICULTY_COUNT] = {
+        ServerGauge::MATCHMAKING_QUEUED_BEGINNER,
+        ServerGauge::MATCHMAKING_QUEUED_INTERMEDIATE,
+        ServerGauge::MATCHMAKING_QUEUED_EXPERT,
+    };
+}
+
+MatchTicket::MatchTicket(Difficulty level, String player)
+    : Level(level)
+    , Player(std::move(player))
+    , EnqueuedAt(Clock::now())
+{
+}
+
+Difficulty MatchTicket::GetDifficulty() const {
+    return Level;
+}
+
+const String& MatchTicket::GetPlayer() const {
+    return Player;
+}
+
+std::shared_ptr<GameSession> MatchTicket::TakeSession() {
+    if (CurrentState.load(std::memory_order_acquire) != State::MATCHED || IsTaken.exchange(true)) {
+        return nullptr;
+    }
+    return std::move(Session);
+}
+
+u32 MatchTicket::GetPlayersInMatch() const {
+    return CurrentState.load(std::memory_order_acquire) == State::MATCHED ? PlayersInMatch : 0;
+}
+
+std::shared_ptr<GameSession> MatchTicket::Cancel() {
+    auto expected = State::WAITING;
+    if (CurrentState.compare_exchange_strong(expected, State::CANCELLED)) {
+        return nullptr;
+    }
+    // The matcher is building the session right now, it won't take long
+    while (CurrentState.load(std::memory_order_acquire) == State::CLAIMED) {
+        std::this_thread::yield();
+    }
+    return TakeSession();
+}
+
+bool MatchTicket::TryClaim() {
+    auto expected = State::WAITING;
+    return CurrentState.compare_exchange_strong(expected, State::CLAIMED);
+}
+
+void MatchTicket::Deliver(std::shared_ptr<GameSession> session, u32 playersInMatch) {
+    Session = std::move(session);
+    PlayersInMatch = playersInMatch;
+    CurrentState.store(State::MATCHED, std::memory_order_release);
+}
+
+Matchmaker::Matchmaker(SessionRegistry& sessions, IGameCompletionListener& listener, const Settings& settings)
+    : Sessions(sessions)
+    , CompletionListener(listener)
+    , Config(settings)
+    , Random(std::random_device()())
+{
+    if (Config.MatchSize == 0) {
+        throw std::runtime_error("Match size should be positive");
+    }
+    for (auto& bucket : Buckets) {
+        bucket.Queue = MakeHolder<TicketQueue>(Config.QueueCapacity);
+    }
+}
+
+Matchmaker::~Matchmaker() {
+    OnTerminate();
+}
+
+void Matchmaker::Start() {
+    Matcher = std::thread([this]() { RunMatcher(); });
+    Log().Info() << "Matchmaking groups " << Config.MatchSize << " players, waiting at most "
+                 << Config.MaxWait.count() << "ms";
+}
+
+void Matchmaker::OnTerminate() {
+    {
+        std::lock_guard<std::mutex> lock(MatcherMutex);
+        ShouldStop = true;
+        MatcherCv.notify_all();
+    }
+    if (Matcher.joinable()) {
+        Matcher.join();
+    }
+}
+
+std::shared_ptr<MatchTicket> Matchmaker::Enqueue(Difficulty level, const String& player) {
+    auto ticket = std::make_shared<MatchTicket>(level, player);
+    if (!Buckets[static_cast<size_t>(level)].Queue->TryPush(ticket)) {
+        return nullptr;
+    }
+    return ticket;
+}
+
+void Matchmaker::RunMatcher() {
+    std::unique_lock<std::mutex> lock(MatcherMutex);
+    while (!MatcherCv.wait_for(lock, MATCH_INTERVAL, [this]() { return ShouldStop; })) {
+        lock.unlock();
+        for (size_t i = 0; i < Buckets.size(); ++i) {
+            Match(static_cast<Difficulty>(i), Buckets[i]);
+        }
+        lock.lock();
+    }
+}
+
+void Matchmaker::Match(Difficulty level, Bucket& bucket) {
+    std::shared_ptr<MatchTicket> ticket;
+    while (bucket.Queue->TryPop(ticket)) {
+        bucket.Pending.push_back(std::move(ticket));
+    }
+
+    auto& pending = bucket.Pending;
+    pending.erase(std::remove_if(pending.begin(), pending.end(), [](const auto& ticket) {
+        return ticket->CurrentState.load(std::memory_order_relaxed) == MatchTicket::State::CANCELLED;
+    }), pending.end());
+
+    while (pending.size() >= Config.MatchSize) {
+        const auto groupEnd = pending.begin() + Config.MatchSize;
+        StartSession(level, {pending.begin(), groupEnd});
+        pending.erase(pending.begin(), groupEnd);
+    }
+    if (!pending.empty() && MatchTicket::Clock::now() - pending.front()->EnqueuedAt >= Config.MaxWait) {
+        StartSession(level, {pending.begin(), pending.end()});
+        pending.clear();
+    }
+
+    Gauges().Set(QUEUED_GAUGES[static_cast<size_t>(level)], static_cast<s64>(pending.size()));
+}
+
+void Matchmaker::StartSession(Difficulty level, std::vector<std::shared_ptr<MatchTicket>> group) {
+    // Whoever cancelled since the last look simply drops out of the group
+    group.erase(std::remove_if(group.begin(), group.end(), [](const auto& ticket) {
+        return !ticket->TryClaim();
+    }), group.end());
+    if (group.empty()) {
+        return;
+    }
+
+    const auto board = *PresetBoard(level);
+    GameSession::Context ctx;
+    ctx.FieldWidth = board.Width;
+    ctx.FieldHeight = board.Height;
+    ctx.MineCount = board.MineCount;
+    auto session = Sessions.Create(ctx, Random(), CompletionListener);
+    // Players adopt the session without connecting again when they pick it up
+    session->OnConnect(static_cast<u32>(group.size()));
+
+    const auto now = MatchTicket::Clock::now();
+    for (const auto& ticket : group) {
+        const auto waited = std::chrono::duration_cast<std::chrono::nanoseconds>(now - ticket->EnqueuedAt);
+        Latency().Record(LatencyProbe::MATCHMAKING_WAIT, static_cast<u64>(waited.count()));
+        ticket->Deliver(session, static_cast<u32>(group.size()));
+    }
+}
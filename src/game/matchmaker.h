@@ -0,0 +1,125 @@
+#pragma once
+
+#include "../termination.h"
+#include "../types.h"
+#include "../util/holder.h"
+#include "../util/mpmc_queue.h"
+#include "../util/string.h"
+#include "difficulty.h"
+#include "game_session.h"
+#include "session_registry.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+// A player's place in the lobby. The connection keeps the ticket and polls
+// it, the matcher fills it in once a session has been made.
+class MatchTicket {
+public:
+    MatchTicket(Difficulty level, String player);
+
+    Difficulty GetDifficulty() const;
+    const String& GetPlayer() const;
+
+    // Returns nullptr until the ticket is matched, the session only once.
+    // It already counts this player, whoever takes it must disconnect later.
+    std::shared_ptr<GameSession> TakeSession();
+    u32 GetPlayersInMatch() const;
+
+    // Withdraws from the lobby. When the match was made just before, the
+    // session is returned so the caller can join or leave it properly.
+    std::shared_ptr<GameSession> Cancel();
+
+public:
+    MatchTicket(const MatchTicket&) = delete;
+    MatchTicket& operator=(const MatchTicket&) = delete;
+
+private:
+    friend class Matchmaker;
+
+    using Clock = std::chrono::steady_clock;
+
+    enum class State : u8 {
+        WAITING,
+        // Held by the matcher only while it builds the session
+        CLAIMED,
+        MATCHED,
+        CANCELLED
+    };
+
+private:
+    const Difficulty Level;
+    const String Player;
+    const Clock::time_point EnqueuedAt;
+    std::atomic<State> CurrentState = {State::WAITING};
+    std::atomic<bool> IsTaken = {false};
+    std::shared_ptr<GameSession> Session;
+    u32 PlayersInMatch = 0;
+
+private:
+    bool TryClaim();
+    void Deliver(std::shared_ptr<GameSession> session, u32 playersInMatch);
+};
+
+// Players queue for a ranked difficulty and get grouped into shared
+// sessions. Every difficulty has its own lock-free queue, so the thousands
+// of connection threads enqueueing at peak never meet on a mutex; a single
+// matcher thread drains the queues, forms groups of MatchSize players and
+// builds their sessions off the connection threads. Players who waited
+// MaxWait without a full group start with whoever is there.
+class Matchmaker final : public ITerminationListener {
+public:
+    struct Settings {
+        size_t QueueCapacity = 4096;
+        u32 MatchSize = 2;
+        std::chrono::milliseconds MaxWait = std::chrono::seconds(5);
+    };
+
+public:
+    Matchmaker(SessionRegistry& sessions, IGameCompletionListener& listener, const Settings& settings);
+    ~Matchmaker();
+
+    void Start();
+    void OnTerminate() override;
+
+    // Returns nullptr when the lobby for this difficulty is full
+    std::shared_ptr<MatchTicket> Enqueue(Difficulty level, const String& player);
+
+public:
+    Matchmaker(const Matchmaker&) = delete;
+    Matchmaker& operator=(const Matchmaker&) = delete;
+
+private:
+    using TicketQueue = MpmcQueue<std::shared_ptr<MatchTicket>>;
+
+    // Owned by the matcher thread
+    struct Bucket {
+        Holder<TicketQueue> Queue;
+        std::deque<std::shared_ptr<MatchTicket>> Pending;
+    };
+
+private:
+    SessionRegistry& Sessions;
+    IGameCompletionListener& CompletionListener;
+    const Settings Config;
+    std::array<Bucket, RANKED_DIFFICULTY_COUNT> Buckets;
+    std::mt19937 Random;
+
+    std::mutex MatcherMutex;
+    std::condition_variable MatcherCv;
+    bool ShouldStop = false;
+    std::thread Matcher;
+
+private:
+    void RunMatcher();
+    void Match(Difficulty level, Bucket& bucket);
+    void StartSession(Difficulty level, std::vector<std::shared_ptr<MatchTicket>> group);
+};
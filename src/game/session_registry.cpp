@@ -0,0 +1,27 @@
+#include "session_registry.h"
+
+SessionRegistry::SessionRegistry(u64 firstId, u64 idStride)
+    : IdStride(idStride)
+    , NextId(firstId)
+{
+}
+
+std::shared_ptr<GameSession> SessionRegistry::Create(const GameSession::Context& ctx, u32 seed,
+                                                     IGameCompletionListener& listener) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    auto session = std::make_shared<GameSession>(ctx, NextId, seed, listener);
+    Sessions.emplace(NextId, session);
+    NextId += IdStride;
+    return session;
+}
+
+std::shared_ptr<GameSession> SessionRegistry::Find(u64 id) const {
+    std::lock_guard<std::mutex> lock(Mutex);
+    const auto it = Sessions.find(id);
+    return it == Sessions.end() ? nullptr : it->second.lock();
+}
+
+void SessionRegistry::Remove(u64 id) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Sessions.erase(id);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "../types.h"
+#include "game_session.h"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// Sessions are owned by their players, the registry only lets other
+// connections (spectators for now) find a running session by id.
+class SessionRegistry {
+public:
+    // Ids are firstId, firstId + idStride, ... so that every cluster worker
+    // hands out ids of its own
+    explicit SessionRegistry(u64 firstId = 1, u64 idStride = 1);
+
+    std::shared_ptr<GameSession> Create(const GameSession::Context& ctx, u32 seed,
+                                        IGameCompletionListener& listener);
+    std::shared_ptr<GameSession> Find(u64 id) const;
+    void Remove(u64 id);
+
+public:
+    SessionRegistry(const SessionRegistry&) = delete;
+    SessionRegistry& operator=(const SessionRegistry&) = delete;
+
+private:
+    mutable std::mutex Mutex;
+    std::unordered_map<u64, std::weak_ptr<GameSession>> Sessions;
+    const u64 IdStride;
+    u64 NextId;
+};
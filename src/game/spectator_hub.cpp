@@ -0,0 +1,231 @@
+#include "spectator_hub.h"
+
+#include "../util/log.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+    StringView ToString(GameSession::Status status) {
+        switch (status) {
+            case GameSession::Status::RUNNING: return "running";
+            case GameSession::Status::WON: return "won";
+            case GameSession::Status::LOST: return "lost";
+        }
+        return "unknown";
+    }
+
+    void WriteMask(std::ostream& out, const std::vector<u64>& mask) {
+        out << std::hex << std::setfill('0');
+        for (const auto word : mask) {
+            out << std::setw(16) << word;
+        }
+        out << std::dec << std::setfill(' ');
+    }
+
+    // SNAPSHOT <session> <sequence> <status> <width> <height> <open mask> <flag mask> <numbers> [<x>,<y>,X]
+    // Masks are little-endian 64 bit words in hex, numbers hold one digit per open cell
+    SpectatorFrame EncodeSnapshot(u64 sessionId, u64 sequence, const GameSession::SpectatorSnapshot& snapshot) {
+        const auto& board = snapshot.Board;
+        std::ostringstream out;
+        out << "SNAPSHOT " << sessionId << ' ' << sequence << ' ' << ToString(snapshot.GameStatus) << ' '
+            << u32(board.Width) << ' ' << u32(board.Height) << ' ';
+        WriteMask(out, board.OpenMask);
+        out << ' ';
+        WriteMask(out, board.FlagMask);
+        out << ' ';
+        for (size_t i = 0; i < board.MinesAround.size(); ++i) {
+            if (board.OpenMask[i / 64] & (u64(1) << (i % 64))) {
+                out << char('0' + board.MinesAround[i]);
+            }
+        }
+        if (snapshot.Explosion) {
+            out << ' ' << u32(snapshot.Explosion->X) << ',' << u32(snapshot.Explosion->Y) << ",X";
+        }
+        out << '\n';
+        return std::make_shared<const String>(out.str());
+    }
+
+    // DELTA <session> <sequence> <status> [<x>,<y>,<state>]...
+    SpectatorFrame EncodeDelta(u64 sessionId, u64 sequence, const GameSession::SpectatorUpdate& update) {
+        std::ostringstream out;
+        out << "DELTA " << sessionId << ' ' << sequence << ' ' << ToString(update.GameStatus);
+        for (const auto& cell : update.Cells) {
+            out << ' ' << u32(cell.X) << ',' << u32(cell.Y) << ',' << cell.State;
+        }
+        out << '\n';
+        return std::make_shared<const String>(out.str());
+    }
+}
+
+SpectatorFeed::SpectatorFeed(u64 sessionId)
+    : SessionId(sessionId)
+{
+}
+
+u64 SpectatorFeed::GetSessionId() const {
+    return SessionId;
+}
+
+void SpectatorFeed::SetOnReady(std::function<void()> onReady) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    OnReady = std::move(onReady);
+}
+
+void SpectatorFeed::Push(const SpectatorFrame& frame) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    if (NeedsResync) {
+        return;
+    }
+    if (Frames.size() >= PENDING_FRAMES_MAX) {
+        Frames.clear();
+        NeedsResync = true;
+    } else {
+        Frames.push_back(frame);
+        // Anything more lands in a queue which the reader is told about already
+        if (Frames.size() == 1 && OnReady) {
+            OnReady();
+        }
+    }
+}
+
+std::vector<SpectatorFrame> SpectatorFeed::Take() {
+    std::lock_guard<std::mutex> lock(Mutex);
+    std::vector<SpectatorFrame> frames(Frames.begin(), Frames.end());
+    Frames.clear();
+    return frames;
+}
+
+void SpectatorFeed::Close() {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Closed = true;
+    if (OnReady) {
+        OnReady();
+    }
+}
+
+bool SpectatorFeed::IsClosed() {
+    std::lock_guard<std::mutex> lock(Mutex);
+    return Closed && Frames.empty();
+}
+
+bool SpectatorFeed::TakeResync() {
+    std::lock_guard<std::mutex> lock(Mutex);
+    const bool needsResync = NeedsResync;
+    NeedsResync = false;
+    return needsResync;
+}
+
+SpectatorHub::SpectatorHub(SessionRegistry& sessions, std::chrono::milliseconds tick)
+    : Sessions(sessions)
+    , Tick(tick)
+{
+}
+
+SpectatorHub::~SpectatorHub() {
+    OnTerminate();
+}
+
+void SpectatorHub::Start() {
+    Ticker = std::thread([this]() { RunTicks(); });
+    Log().Info() << "Spectator broadcasts are sent every " << Tick.count() << "ms";
+}
+
+void SpectatorHub::OnTerminate() {
+    {
+        std::lock_guard<std::mutex> lock(TickMutex);
+        ShouldStop = true;
+        TickCv.notify_all();
+    }
+    if (Ticker.joinable()) {
+        Ticker.join();
+    }
+}
+
+std::shared_ptr<SpectatorFeed> SpectatorHub::Watch(u64 sessionId) {
+    auto session = Sessions.Find(sessionId);
+    if (!session) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(Mutex);
+    auto& channel = Channels[sessionId];
+    if (channel.Feeds.empty()) {
+        channel.Session = session;
+        session->SetWatched(true);
+    }
+
+    auto feed = std::make_shared<SpectatorFeed>(sessionId);
+    channel.Feeds.push_back(feed);
+    PushSnapshot(*session, channel, *feed);
+    return feed;
+}
+
+void SpectatorHub::Unwatch(const std::shared_ptr<SpectatorFeed>& feed) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    const auto it = Channels.find(feed->GetSessionId());
+    if (it == Channels.end()) {
+        return;
+    }
+
+    auto& feeds = it->second.Feeds;
+    feeds.erase(std::remove(feeds.begin(), feeds.end(), feed), feeds.end());
+    if (feeds.empty()) {
+        if (auto session = it->second.Session.lock()) {
+            session->SetWatched(false);
+        }
+        Channels.erase(it);
+    }
+}
+
+void SpectatorHub::Resync(SpectatorFeed& feed) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    const auto it = Channels.find(feed.GetSessionId());
+    if (it == Channels.end()) {
+        return;
+    }
+    if (auto session = it->second.Session.lock()) {
+        PushSnapshot(*session, it->second, feed);
+    }
+}
+
+void SpectatorHub::RunTicks() {
+    std::unique_lock<std::mutex> lock(TickMutex);
+    while (!TickCv.wait_for(lock, Tick, [this]() { return ShouldStop; })) {
+        lock.unlock();
+        Broadcast();
+        lock.lock();
+    }
+}
+
+void SpectatorHub::Broadcast() {
+    std::lock_guard<std::mutex> lock(Mutex);
+    for (auto it = Channels.begin(); it != Channels.end();) {
+        auto& channel = it->second;
+        auto session = channel.Session.lock();
+        if (!session) {
+            const auto frame = std::make_shared<const String>("CLOSED " + std::to_string(it->first) + "\n");
+            for (auto& feed : channel.Feeds) {
+                feed->Push(frame);
+                feed->Close();
+            }
+            it = Channels.erase(it);
+            continue;
+        }
+
+        const auto update = session->CollectSpectatorUpdate();
+        if (!update.Cells.empty() || update.GameStatus != channel.LastStatus) {
+            channel.LastStatus = update.GameStatus;
+            const auto frame = EncodeDelta(it->first, ++channel.Sequence, update);
+            for (auto& feed : channel.Feeds) {
+                feed->Push(frame);
+            }
+        }
+        ++it;
+    }
+}
+
+void SpectatorHub::PushSnapshot(GameSession& session, const Channel& channel, SpectatorFeed& feed) {
+    feed.Push(EncodeSnapshot(session.GetId(), channel.Sequence, session.TakeSpectatorSnapshot()));
+}
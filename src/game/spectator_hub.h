@@ -0,0 +1,100 @@
+#pragma once
+
+#include "../termination.h"
+#include "../types.h"
+#include "../util/string.h"
+#include "game_session.h"
+#include "session_registry.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Frames are encoded once per tick and shared by every spectator of a session
+using SpectatorFrame = std::shared_ptr<const String>;
+
+// Per-spectator queue. The hub never waits for a spectator: when a spectator
+// falls PENDING_FRAMES_MAX frames behind its queue is dropped and it gets a
+// fresh snapshot instead.
+class SpectatorFeed {
+public:
+    static constexpr size_t PENDING_FRAMES_MAX = 64;
+
+public:
+    explicit SpectatorFeed(u64 sessionId);
+
+    u64 GetSessionId() const;
+
+    // Called by the pushing thread, under the feed's lock, whenever the feed
+    // goes from nothing to take to something to take or is closed
+    void SetOnReady(std::function<void()> onReady);
+
+    void Push(const SpectatorFrame& frame);
+    // Never blocks
+    std::vector<SpectatorFrame> Take();
+    bool TakeResync();
+    void Close();
+    bool IsClosed();
+
+public:
+    SpectatorFeed(const SpectatorFeed&) = delete;
+    SpectatorFeed& operator=(const SpectatorFeed&) = delete;
+
+private:
+    const u64 SessionId;
+    std::mutex Mutex;
+    std::deque<SpectatorFrame> Frames;
+    bool NeedsResync = false;
+    bool Closed = false;
+    std::function<void()> OnReady;
+};
+
+class SpectatorHub final : public ITerminationListener {
+public:
+    SpectatorHub(SessionRegistry& sessions, std::chrono::milliseconds tick);
+    ~SpectatorHub();
+
+    void Start();
+    void OnTerminate() override;
+
+    // Returns nullptr when there is no such session, otherwise the feed
+    // already holds a snapshot of the session
+    std::shared_ptr<SpectatorFeed> Watch(u64 sessionId);
+    void Unwatch(const std::shared_ptr<SpectatorFeed>& feed);
+    void Resync(SpectatorFeed& feed);
+
+public:
+    SpectatorHub(const SpectatorHub&) = delete;
+    SpectatorHub& operator=(const SpectatorHub&) = delete;
+
+private:
+    struct Channel {
+        std::weak_ptr<GameSession> Session;
+        std::vector<std::shared_ptr<SpectatorFeed>> Feeds;
+        GameSession::Status LastStatus = GameSession::Status::RUNNING;
+        u64 Sequence = 0;
+    };
+
+private:
+    SessionRegistry& Sessions;
+    const std::chrono::milliseconds Tick;
+
+    std::mutex Mutex;
+    std::unordered_map<u64, Channel> Channels;
+
+    std::mutex TickMutex;
+    std::condition_variable TickCv;
+    bool ShouldStop = false;
+    std::thread Ticker;
+
+private:
+    void RunTicks();
+    void Broadcast();
+    void PushSnapshot(GameSession& session, const Channel& channel, SpectatorFeed& feed);
+};
@@ -1,10 +1,14 @@
 #include "application.h"
+#include "simulation.h"
 
 #include <exception>
 #include <iostream>
 
 int main(int argc, const char** argv) {
     try {
+        if (IsSimulation(argc, argv)) {
+            return RunSimulation(ParseSimulationArguments(argc, argv));
+        }
         auto& instance = Application::GetInstance(argc, argv);
         return instance.Run();
     } catch (const std::exception& e) {
@@ -0,0 +1,151 @@
+#include "metrics_server.h"
+
+#include "util/counters.h"
+#include "util/latency.h"
+#include "util/log.h"
+
+#include <Poco/Net/HTTPRequestHandler.h>
+#include <Poco/Net/HTTPRequestHandlerFactory.h>
+#include <Poco/Net/HTTPServer.h>
+#include <Poco/Net/HTTPServerParams.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <Poco/Net/ServerSocket.h>
+
+#include <iomanip>
+#include <sstream>
+
+using namespace Poco::Net;
+
+namespace {
+    constexpr auto METRIC_PREFIX = "minesweeper_";
+    constexpr f64 NANOSECONDS_PER_SECOND = 1e9;
+    constexpr f64 QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+
+    void RenderCounters(std::ostream& out) {
+        for (size_t i = 0; i < SERVER_COUNTER_COUNT; ++i) {
+            const auto counter = static_cast<ServerCounter>(i);
+            const auto name = ToString(counter);
+            out << "# TYPE " << METRIC_PREFIX << name << "_total counter\n"
+                << METRIC_PREFIX << name << "_total " << Counters().Get(counter) << '\n';
+        }
+    }
+
+    void RenderGauges(std::ostream& out) {
+        for (size_t i = 0; i < SERVER_GAUGE_COUNT; ++i) {
+            const auto gauge = static_cast<ServerGauge>(i);
+            const auto name = ToString(gauge);
+            out << "# TYPE " << METRIC_PREFIX << name << " gauge\n"
+                << METRIC_PREFIX << name << ' ' << Gauges().Get(gauge) << '\n';
+        }
+    }
+
+    void RenderLatencies(std::ostream& out) {
+#if defined(MINESWEEPER_LATENCY_PROBES)
+        for (size_t i = 0; i < LATENCY_PROBE_COUNT; ++i) {
+            const auto probe = static_cast<LatencyProbe>(i);
+            const auto name = ToString(probe);
+            const auto snapshot = Latency().Collect(probe);
+            out << "# TYPE " << METRIC_PREFIX << name << "_seconds summary\n";
+            for (const auto quantile : QUANTILES) {
+                out << METRIC_PREFIX << name << "_seconds{quantile=\"" << quantile << "\"} "
+                    << snapshot.Percentile(quantile * 100) / NANOSECONDS_PER_SECOND << '\n';
+            }
+            out << METRIC_PREFIX << name << "_seconds_sum " << snapshot.Sum / NANOSECONDS_PER_SECOND << '\n'
+                << METRIC_PREFIX << name << "_seconds_count " << snapshot.TotalCount << '\n';
+        }
+#else
+        static_cast<void>(out);
+#endif
+    }
+
+    String RenderPrometheus() {
+        std::ostringstream out;
+        out << std::setprecision(9);
+        RenderCounters(out);
+        RenderGauges(out);
+        RenderLatencies(out);
+        return out.str();
+    }
+
+    void SendText(HTTPServerResponse& response, HTTPResponse::HTTPStatus status, const String& body) {
+        response.setStatusAndReason(status);
+        response.setContentType("text/plain; version=0.0.4; charset=utf-8");
+        response.setContentLength(static_cast<long>(body.size()));
+        response.sendBuffer(body.data(), body.size());
+    }
+}
+
+class MetricsRequestHandler final : public HTTPRequestHandler {
+public:
+    void handleRequest(HTTPServerRequest& request, HTTPServerResponse& response) override {
+        Counters().Add(ServerCounter::METRICS_REQUESTS);
+        if (request.getMethod() != HTTPRequest::HTTP_GET) {
+            SendText(response, HTTPResponse::HTTP_METHOD_NOT_ALLOWED, "Method not allowed\n");
+            return;
+        }
+
+        const auto& uri = request.getURI();
+        if (uri == "/metrics") {
+            SendText(response, HTTPResponse::HTTP_OK, RenderPrometheus());
+        } else if (uri == "/healthz") {
+            SendText(response, HTTPResponse::HTTP_OK, "ok\n");
+        } else {
+            SendText(response, HTTPResponse::HTTP_NOT_FOUND, "Not found\n");
+        }
+    }
+};
+
+class MetricsRequestHandlerFactory final : public HTTPRequestHandlerFactory {
+public:
+    HTTPRequestHandler* createRequestHandler(const HTTPServerRequest&) override {
+        return new MetricsRequestHandler();
+    }
+};
+
+class MetricsServer final : public IMetricsServer {
+public:
+    explicit MetricsServer(u16 port)
+        : Server(new MetricsRequestHandlerFactory(), ServerSocket(port), CreateParams())
+    {
+        Log().Info() << "Metrics server is listening for connections on port " << port;
+    }
+
+    ~MetricsServer() {
+        Server.stop();
+    }
+
+    void Start() override {
+        Server.start();
+        Log().Info() << "Metrics server started";
+    }
+
+    void OnTerminate() override {
+        Server.stop();
+        Log().Info() << "Metrics server stopped";
+    }
+
+private:
+    // Scrapes are rare and cheap, a couple of threads is enough and keeps
+    // a misbehaving scraper from eating cores the game needs
+    static constexpr int MAX_THREADS = 2;
+    static constexpr int MAX_QUEUED = 16;
+
+    HTTPServer Server;
+
+private:
+    static HTTPServerParams::Ptr CreateParams() {
+        HTTPServerParams::Ptr params = new HTTPServerParams();
+        params->setMaxThreads(MAX_THREADS);
+        params->setMaxQueued(MAX_QUEUED);
+        params->setKeepAlive(false);
+        return params;
+    }
+};
+
+Holder<IMetricsServer> IMetricsServer::Create(const ServerConfig& config) {
+    if (!config.MetricsPort) {
+        return nullptr;
+    }
+    return MakeHolder<MetricsServer>(*config.MetricsPort);
+}
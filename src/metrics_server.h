@@ -0,0 +1,15 @@
+#pragma once
+
+#include "server_config.h"
+#include "termination.h"
+#include "util/holder.h"
+
+class IMetricsServer : public ITerminationListener {
+public:
+    static Holder<IMetricsServer> Create(const ServerConfig& config);
+
+public:
+    virtual ~IMetricsServer() = default;
+
+    virtual void Start() = 0;
+};
@@ -0,0 +1,116 @@
+#include "output_queue.h"
+
+#include "util/latency.h"
+#include "util/log.h"
+
+#include <Poco/Net/NetException.h>
+#include <Poco/Net/Socket.h>
+
+#include <algorithm>
+
+using namespace Poco::Net;
+
+const char* OutputQueue::Chunk::Data() const {
+    return (Shared ? Shared->data() : Owned.data()) + Offset;
+}
+
+size_t OutputQueue::Chunk::Length() const {
+    return (Shared ? Shared->size() : Owned.size()) - Offset;
+}
+
+OutputQueue::OutputQueue(const Limits& limits)
+    : QueueLimits(limits)
+{
+}
+
+void OutputQueue::Push(String message) {
+    if (message.empty()) {
+        return;
+    }
+    Bytes += message.size();
+    if (!Chunks.empty() && !Chunks.back().Shared
+        && Chunks.back().Owned.size() + message.size() <= COALESCE_BYTES_MAX) {
+        Chunks.back().Owned += message;
+    } else {
+        Chunks.push_back({nullptr, std::move(message)});
+    }
+    UpdateBacklog();
+}
+
+void OutputQueue::Push(const SharedBuffer& buffer) {
+    if (!buffer || buffer->empty()) {
+        return;
+    }
+    Bytes += buffer->size();
+    Chunks.push_back({buffer, {}});
+    UpdateBacklog();
+}
+
+OutputQueue::FlushStatus OutputQueue::Flush(StreamSocket& socket) {
+    SocketBufVec buffers;
+    buffers.reserve(BUFFERS_PER_SEND_MAX);
+    while (!Chunks.empty()) {
+        buffers.clear();
+        size_t bytesToSend = 0;
+        const size_t count = std::min(Chunks.size(), BUFFERS_PER_SEND_MAX);
+        for (size_t i = 0; i < count; ++i) {
+            const auto& chunk = Chunks[i];
+            buffers.push_back(Socket::makeBuffer(const_cast<char*>(chunk.Data()), chunk.Length()));
+            bytesToSend += chunk.Length();
+        }
+
+        int bytesSent = 0;
+        try {
+            LATENCY_SCOPE(LatencyProbe::SOCKET_SEND);
+            bytesSent = socket.sendBytes(buffers);
+        } catch (const Poco::Exception& ex) {
+            Log().Warn() << "Cannot send to " << socket.peerAddress().toString() << ": " << ex.displayText();
+            return FlushStatus::FAILED;
+        }
+
+        // Negative result means the socket would block
+        if (bytesSent <= 0) {
+            return FlushStatus::PENDING;
+        }
+        Consume(static_cast<size_t>(bytesSent));
+        if (static_cast<size_t>(bytesSent) < bytesToSend) {
+            return FlushStatus::PENDING;
+        }
+    }
+    return FlushStatus::DRAINED;
+}
+
+bool OutputQueue::IsEmpty() const {
+    return Chunks.empty();
+}
+
+size_t OutputQueue::Size() const {
+    return Bytes;
+}
+
+bool OutputQueue::IsBacklogged() const {
+    return Backlogged;
+}
+
+void OutputQueue::Consume(size_t bytes) {
+    Bytes -= bytes;
+    while (bytes > 0) {
+        auto& chunk = Chunks.front();
+        const size_t length = chunk.Length();
+        if (bytes < length) {
+            chunk.Offset += bytes;
+            break;
+        }
+        bytes -= length;
+        Chunks.pop_front();
+    }
+    UpdateBacklog();
+}
+
+void OutputQueue::UpdateBacklog() {
+    if (Bytes >= QueueLimits.HighWatermark) {
+        Backlogged = true;
+    } else if (Bytes <= QueueLimits.LowWatermark) {
+        Backlogged = false;
+    }
+}
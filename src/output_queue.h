@@ -0,0 +1,72 @@
+#pragma once
+
+#include "types.h"
+#include "util/string.h"
+
+#include <Poco/Net/StreamSocket.h>
+
+#include <deque>
+#include <memory>
+
+// Immutable buffer which may be queued on many connections at once
+using SharedBuffer = std::shared_ptr<const String>;
+
+// Outgoing bytes of one connection. Small messages are coalesced into the
+// tail buffer, everything pending is written with one scatter-gather send
+// and partial writes keep their offset until the socket is writable again.
+class OutputQueue {
+public:
+    struct Limits {
+        size_t LowWatermark = 64 * 1024;
+        size_t HighWatermark = 256 * 1024;
+    };
+
+    enum class FlushStatus : u8 {
+        DRAINED,
+        PENDING,
+        FAILED
+    };
+
+public:
+    explicit OutputQueue(const Limits& limits);
+
+    void Push(String message);
+    void Push(const SharedBuffer& buffer);
+
+    // Never blocks on a non-blocking socket
+    FlushStatus Flush(Poco::Net::StreamSocket& socket);
+
+    bool IsEmpty() const;
+    size_t Size() const;
+
+    // Set once the queue grows past the high watermark and cleared only
+    // when it drains below the low one
+    bool IsBacklogged() const;
+
+public:
+    OutputQueue(const OutputQueue&) = delete;
+    OutputQueue& operator=(const OutputQueue&) = delete;
+
+private:
+    static constexpr size_t COALESCE_BYTES_MAX = 4096;
+    static constexpr size_t BUFFERS_PER_SEND_MAX = 64;
+
+    struct Chunk {
+        SharedBuffer Shared;
+        String Owned;
+        size_t Offset = 0;
+
+        const char* Data() const;
+        size_t Length() const;
+    };
+
+private:
+    const Limits QueueLimits;
+    std::deque<Chunk> Chunks;
+    size_t Bytes = 0;
+    bool Backlogged = false;
+
+private:
+    void Consume(size_t bytes);
+    void UpdateBacklog();
+};
@@ -0,0 +1,697 @@
+#include "player_connection_manager.h"
+
+#include "buffered_connection.h"
+#include "cluster.h"
+#include "player_protocol.h"
+#include "game/game_session.h"
+#include "util/client_error.h"
+#include "util/counters.h"
+#include "util/log.h"
+#include "util/maybe.h"
+#include "util/string.h"
+#include "websocket_codec.h"
+
+#include <Poco/Net/HTTPRequestHandler.h>
+#include <Poco/Net/HTTPRequestHandlerFactory.h>
+#include <Poco/Net/HTTPServer.h>
+#include <Poco/Net/HTTPServerParams.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerRequestImpl.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <Poco/Net/ServerSocket.h>
+#include <Poco/Net/TCPServer.h>
+#include <Poco/String.h>
+#include <Poco/ThreadPool.h>
+#include <Poco/Timespan.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <random>
+#include <sstream>
+
+using namespace Poco::Net;
+
+namespace {
+    constexpr size_t PLAYER_NAME_LENGTH_MAX = 16;
+    constexpr u32 TOP_COUNT_DEFAULT = 10;
+
+    bool IsValidPlayerName(StringView name) {
+        if (name.empty() || name.size() > PLAYER_NAME_LENGTH_MAX) {
+            return false;
+        }
+        for (const char c : name) {
+            if (!isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-') {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    constexpr StringView NO_GAME_MESSAGE = "No game in progress, use NEW first";
+    constexpr long WEBSOCKET_HANDSHAKE_TIMEOUT_US = 5 * 1000 * 1000;
+}
+
+struct PlayerConnectionContext {
+    const PlayerServices Services;
+    const OutputQueue::Limits OutputLimits;
+    std::atomic<u32>& ActiveConnections;
+    std::atomic<bool>& IsStopping;
+    const u32 MaxConnections;
+    // For native connections, cluster workers only hear from their router
+    const AdmissionControl::Kind NativeAdmission;
+};
+
+namespace {
+    // The slot is given back when the connection is destroyed
+    bool ReserveSlot(PlayerConnectionContext& ctx) {
+        u32 active = ctx.ActiveConnections.load();
+        do {
+            if (active >= ctx.MaxConnections) {
+                return false;
+            }
+        } while (!ctx.ActiveConnections.compare_exchange_weak(active, active + 1));
+        return true;
+    }
+
+    bool AdmitPlayer(PlayerConnectionContext& ctx, const IPAddress& host, AdmissionControl::Kind kind) {
+        if (!ctx.Services.Admission.Admit(host, kind)) {
+            return false;
+        }
+        const bool accepted = ReserveSlot(ctx);
+        Counters().Add(accepted
+                       ? ServerCounter::PLAYER_CONNECTIONS_ACCEPTED
+                       : ServerCounter::PLAYER_CONNECTIONS_REJECTED);
+        return accepted;
+    }
+}
+
+class PlayerConnectionFilter : public TCPServerConnectionFilter {
+public:
+    explicit PlayerConnectionFilter(PlayerConnectionContext& ctx)
+        : Ctx(ctx)
+    {
+    }
+
+    bool accept(const StreamSocket& socket) override {
+        return AdmitPlayer(Ctx, socket.peerAddress().host(), Ctx.NativeAdmission);
+    }
+
+private:
+    PlayerConnectionContext& Ctx;
+};
+
+template <typename S>
+class PlayerConnectionFactory final : public TCPServerConnectionFactory {
+public:
+    PlayerConnectionFactory(PlayerConnectionContext& ctx)
+        : TCPServerConnectionFactory()
+        , Ctx(ctx)
+    {
+    }
+
+    TCPServerConnection* createConnection(const StreamSocket& socket) {
+        return new S(socket, Ctx);
+    }
+
+private:
+    PlayerConnectionContext& Ctx;
+};
+
+class PlayerConnection : public BufferedConnection {
+public:
+    PlayerConnection(const StreamSocket& socket, PlayerConnectionContext& ctx)
+        : BufferedConnection(socket, ctx.OutputLimits)
+        , Ctx(ctx)
+        , Random(std::random_device()())
+    {
+        Log().Info() << "New player connection from: " << Socket.peerAddress().toString();
+    }
+
+    ~PlayerConnection() {
+        StopWatching();
+        LeaveQueue();
+        LeaveSession();
+        Ctx.ActiveConnections.fetch_sub(1);
+        Log().Info() << "Player connection closed";
+    }
+
+protected:
+    void OnReceive(StringView data) override {
+        OnText(data);
+    }
+
+    // Newline separated commands, however the transport cut them. A command
+    // is timed from the moment its bytes arrived, so waiting behind the
+    // commands before it counts too.
+    void OnText(StringView data) {
+        const auto received = ScopedLatencyTimer::Clock::now();
+        PendingInput.append(data);
+        size_t lineBegin = 0;
+        for (auto lineEnd = PendingInput.find('\n'); lineEnd != String::npos && !IsClosed();
+             lineEnd = PendingInput.find('\n', lineBegin)) {
+            const auto line = Strip(StringView(PendingInput).substr(lineBegin, lineEnd - lineBegin));
+            lineBegin = lineEnd + 1;
+            if (!line.empty()) {
+                LATENCY_SCOPE_SINCE(LatencyProbe::PLAYER_COMMAND, received);
+                SendMessage(OnCommand(line));
+            }
+        }
+        PendingInput.erase(0, lineBegin);
+
+        if (PendingInput.size() > LINE_LENGTH_MAX) {
+            SendMessage("ERROR Line is too long\n");
+            Close();
+        }
+    }
+
+    virtual void SendMessage(String message) {
+        Send(std::move(message));
+    }
+
+    virtual void SendMessage(const SharedBuffer& frame) {
+        Send(frame);
+    }
+
+private:
+    static constexpr size_t LINE_LENGTH_MAX = 256;
+    // Matches are made every few tens of milliseconds
+    static constexpr long QUEUED_POLL_TIMEOUT_US = 20 * 1000;
+
+    PlayerConnectionContext& Ctx;
+    String PendingInput;
+    String PlayerName = "anonymous";
+    std::shared_ptr<GameSession> Session;
+    std::shared_ptr<SpectatorFeed> Feed;
+    // Created on the first WATCH, the feed signals it when frames are ready
+    Holder<PollWakeup> FeedWakeup;
+    std::shared_ptr<MatchTicket> Ticket;
+    Maybe<u64> UdpToken;
+    std::mt19937 Random;
+
+private:
+    bool ShouldStop() const override {
+        return Ctx.IsStopping.load();
+    }
+
+    long PollTimeoutUs() const override {
+        return Ticket ? QUEUED_POLL_TIMEOUT_US : POLL_TIMEOUT_US;
+    }
+
+    // Frames are left in the feed while the peer is backlogged, waking up
+    // for them would only spin
+    PollWakeup* ActiveWakeup() override {
+        return Feed && !IsSendBacklogged() ? FeedWakeup.get() : nullptr;
+    }
+
+    void OnTick() override {
+        if (Ticket) {
+            if (auto session = Ticket->TakeSession()) {
+                SendMessage(OnMatched(std::move(session)));
+            }
+        }
+        if (Feed) {
+            ForwardSpectatorFrames();
+        }
+    }
+
+    String OnCommand(StringView line) {
+        try {
+            const auto words = SplitWords(line);
+            const auto command = words.front();
+            if (command == "NAME" && words.size() == 2) {
+                return OnName(words[1]);
+            }
+            if (command == "NEW" && words.size() == 4) {
+                return OnNew(words[1], words[2], words[3]);
+            }
+            if ((command == "OPEN" || command == "FLAG") && words.size() == 3) {
+                return OnMove(words);
+            }
+            if (command == "TOP" && (words.size() == 2 || words.size() == 3)) {
+                return OnTop(words[1], words.size() == 3 ? ParseUnsigned(words[2]) : Maybe<u32>(TOP_COUNT_DEFAULT));
+            }
+            if (command == "RANK" && words.size() == 3) {
+                return OnRank(words[1], ParseUnsigned(words[2]));
+            }
+            if (command == "WATCH" && words.size() == 2) {
+                return OnWatch(ParseUnsigned(words[1]));
+            }
+            if (command == "QUEUE" && words.size() == 2) {
+                return OnQueue(words[1]);
+            }
+            if (command == "DEQUEUE" && words.size() == 1) {
+                return LeaveQueue();
+            }
+            if (command == "UDP" && words.size() == 1) {
+                return OnUdp();
+            }
+            if (command == "UNWATCH" && words.size() == 1) {
+                StopWatching();
+                return "OK\n";
+            }
+            return "ERROR Unknown command\n";
+        } catch (const ClientError& error) {
+            return "ERROR " + error.Message() + "\n";
+        }
+    }
+
+    String OnName(StringView name) {
+        if (!IsValidPlayerName(name)) {
+            throw ClientError("Name should be 1-16 letters, digits, '_' or '-'");
+        }
+        PlayerName = String(name);
+        return "OK\n";
+    }
+
+    String OnNew(StringView width, StringView height, StringView mineCount) {
+        const auto parsedWidth = ParseUnsigned(width);
+        const auto parsedHeight = ParseUnsigned(height);
+        const auto parsedMineCount = ParseUnsigned(mineCount);
+        if (!parsedWidth || !parsedHeight || !parsedMineCount
+            || *parsedWidth > UINT8_MAX || *parsedHeight > UINT8_MAX) {
+            throw ClientError("Usage: NEW <width> <height> <mines>");
+        }
+
+        GameSession::Context ctx;
+        ctx.FieldWidth = static_cast<u8>(*parsedWidth);
+        ctx.FieldHeight = static_cast<u8>(*parsedHeight);
+        ctx.MineCount = *parsedMineCount;
+        const auto error = Field::CheckParameters(ctx.FieldWidth, ctx.FieldHeight, ctx.MineCount);
+        if (error != Field::Error::NONE) {
+            throw ClientError(String(Describe(error)));
+        }
+
+        JoinSession(Ctx.Services.Sessions.Create(ctx, Random(), Ctx.Services.Board));
+        return "OK " + String(ToString(Session->GetDifficulty())) + " " + std::to_string(Session->GetId()) + "\n";
+    }
+
+    String OnQueue(StringView difficulty) {
+        const auto level = ParseDifficulty(difficulty);
+        if (!level || !IsRanked(*level)) {
+            throw ClientError("Usage: QUEUE <beginner|intermediate|expert>");
+        }
+        if (Ticket) {
+            throw ClientError("Already queued, use DEQUEUE first");
+        }
+        Ticket = Ctx.Services.Lobby.Enqueue(*level, PlayerName);
+        if (!Ticket) {
+            throw ClientError("Lobby is full, try again later");
+        }
+        return "OK\n";
+    }
+
+    // MATCHED <difficulty> <session> <players>
+    String OnMatched(std::shared_ptr<GameSession> session) {
+        const u32 players = Ticket->GetPlayersInMatch();
+        Ticket.reset();
+        AdoptSession(std::move(session));
+        return "MATCHED " + String(ToString(Session->GetDifficulty())) + " " + std::to_string(Session->GetId())
+               + " " + std::to_string(players) + "\n";
+    }
+
+    String LeaveQueue() {
+        if (!Ticket) {
+            return "OK\n";
+        }
+        if (auto session = Ticket->Cancel()) {
+            return OnMatched(std::move(session));
+        }
+        Ticket.reset();
+        return "OK\n";
+    }
+
+    void JoinSession(std::shared_ptr<GameSession> session) {
+        AdoptSession(std::move(session));
+        Session->OnConnect();
+    }
+
+    // For sessions which already count this player
+    void AdoptSession(std::shared_ptr<GameSession> session) {
+        LeaveSession();
+        Session = std::move(session);
+    }
+
+    void LeaveSession() {
+        UnbindUdp();
+        if (Session) {
+            if (Session->OnDisconnect()) {
+                Ctx.Services.Sessions.Remove(Session->GetId());
+            }
+            Session.reset();
+        }
+    }
+
+    String OnUdp() {
+        if (!Ctx.Services.Udp) {
+            throw ClientError("UDP transport is disabled");
+        }
+        if (!Session) {
+            throw ClientError(String(NO_GAME_MESSAGE));
+        }
+        UnbindUdp();
+        UdpToken = Ctx.Services.Udp->Bind(Session, PlayerName, Socket.peerAddress().host());
+        return "UDP " + std::to_string(Ctx.Services.Udp->GetPort()) + " " + std::to_string(*UdpToken) + "\n";
+    }
+
+    void UnbindUdp() {
+        if (UdpToken) {
+            Ctx.Services.Udp->Unbind(*UdpToken);
+            UdpToken = Nothing<u64>();
+        }
+    }
+
+    String OnMove(const std::vector<StringView>& words) {
+        const auto move = ParseMove(words);
+        if (!move) {
+            return ErrorAnswer("Usage: OPEN|FLAG <x> <y>");
+        }
+        if (!Session) {
+            return ErrorAnswer(NO_GAME_MESSAGE);
+        }
+        return ApplyMove(*Session, *move, PlayerName, Ctx.Services.Board);
+    }
+
+    String OnTop(StringView difficulty, const Maybe<u32>& count) {
+        const auto level = ParseDifficulty(difficulty);
+        if (!level || !IsRanked(*level) || !count) {
+            throw ClientError("Usage: TOP <beginner|intermediate|expert> [count]");
+        }
+
+        const auto entries = Ctx.Services.Board.Top(*level, std::min<size_t>(*count, Leaderboard::TOP_SIZE));
+        std::ostringstream answer;
+        answer << "TOP " << difficulty << ' ' << entries.size() << '\n';
+        for (size_t i = 0; i < entries.size(); ++i) {
+            answer << i + 1 << ' ' << entries[i].DurationMs << ' ' << entries[i].Player << '\n';
+        }
+        return answer.str();
+    }
+
+    String OnRank(StringView difficulty, const Maybe<u32>& durationMs) {
+        const auto level = ParseDifficulty(difficulty);
+        if (!level || !IsRanked(*level) || !durationMs) {
+            throw ClientError("Usage: RANK <beginner|intermediate|expert> <milliseconds>");
+        }
+
+        std::ostringstream answer;
+        answer << "RANK " << difficulty << ' ' << Ctx.Services.Board.Rank(*level, *durationMs)
+               << ' ' << Ctx.Services.Board.Size(*level) << '\n';
+        return answer.str();
+    }
+
+    String OnWatch(const Maybe<u32>& sessionId) {
+        if (!sessionId) {
+            throw ClientError("Usage: WATCH <session>");
+        }
+        StopWatching();
+        Feed = Ctx.Services.Spectators.Watch(*sessionId);
+        if (!Feed) {
+            throw ClientError("No such session: " + std::to_string(*sessionId));
+        }
+        if (!FeedWakeup) {
+            FeedWakeup = MakeHolder<PollWakeup>();
+        }
+        // The snapshot pushed by Watch is taken by the next OnTick. The hub
+        // stops pushing on Unwatch, which runs before the wakeup goes away.
+        Feed->SetOnReady([wakeup = FeedWakeup.get()]() { wakeup->Signal(); });
+        return "OK\n";
+    }
+
+    void StopWatching() {
+        if (Feed) {
+            Ctx.Services.Spectators.Unwatch(Feed);
+            Feed.reset();
+        }
+    }
+
+    // Runs on this connection's thread, so a slow spectator socket only
+    // ever delays its own feed. While the socket is backlogged the feed is
+    // left to overflow, which turns into a single snapshot once it drains.
+    void ForwardSpectatorFrames() {
+        if (IsSendBacklogged()) {
+            return;
+        }
+        if (Feed->TakeResync()) {
+            Ctx.Services.Spectators.Resync(*Feed);
+        }
+
+        for (const auto& frame : Feed->Take()) {
+            SendMessage(frame);
+        }
+        if (Feed->IsClosed()) {
+            Feed.reset();
+        }
+    }
+};
+
+// Every WebSocket message carries commands and every answer goes back as a
+// message of its own. Frames are a header queued in front of the unchanged
+// answer, so spectator frames stay the buffers shared by all watchers; only
+// payloads big enough to be worth it are deflated per connection.
+class WebSocketPlayerConnection final : public PlayerConnection {
+public:
+    WebSocketPlayerConnection(const StreamSocket& socket, PlayerConnectionContext& ctx, bool deflate)
+        : PlayerConnection(socket, ctx)
+        , Codec(deflate, MESSAGE_BYTES_MAX)
+    {
+    }
+
+private:
+    static constexpr size_t MESSAGE_BYTES_MAX = 4096;
+
+    WebSocketCodec Codec;
+    std::vector<WebSocketCodec::Message> Messages;
+
+private:
+    void OnReceive(StringView data) override {
+        Messages.clear();
+        const auto status = Codec.Decode(data, Messages);
+        for (auto& message : Messages) {
+            if (IsClosed()) {
+                return;
+            }
+            OnMessage(message);
+        }
+        if (status != WebSocketCodec::Status::OK && !IsClosed()) {
+            Send(WebSocketCodec::CloseFrame(status == WebSocketCodec::Status::MESSAGE_TOO_BIG
+                                            ? WebSocketCodec::CLOSE_MESSAGE_TOO_BIG
+                                            : WebSocketCodec::CLOSE_PROTOCOL_ERROR));
+            Close();
+        }
+    }
+
+    void OnMessage(WebSocketCodec::Message& message) {
+        switch (message.Type) {
+            case WebSocketCodec::Opcode::TEXT:
+            case WebSocketCodec::Opcode::BINARY:
+                // Browsers send a command per message without the newline
+                if (message.Payload.empty() || message.Payload.back() != '\n') {
+                    message.Payload.push_back('\n');
+                }
+                OnText(message.Payload);
+                break;
+            case WebSocketCodec::Opcode::PING:
+                Send(WebSocketCodec::Header(WebSocketCodec::Opcode::PONG, message.Payload.size()));
+                Send(std::move(message.Payload));
+                break;
+            case WebSocketCodec::Opcode::CLOSE:
+                Send(WebSocketCodec::CloseFrame(WebSocketCodec::CLOSE_NORMAL));
+                Close();
+                break;
+            case WebSocketCodec::Opcode::CONTINUATION:
+            case WebSocketCodec::Opcode::PONG:
+                break;
+        }
+    }
+
+    void SendMessage(String message) override {
+        if (auto compressed = Codec.Compress(message)) {
+            Send(WebSocketCodec::Header(WebSocketCodec::Opcode::TEXT, compressed->size(), true));
+            Send(std::move(*compressed));
+            return;
+        }
+        Send(WebSocketCodec::Header(WebSocketCodec::Opcode::TEXT, message.size()));
+        Send(std::move(message));
+    }
+
+    void SendMessage(const SharedBuffer& frame) override {
+        if (auto compressed = Codec.Compress(*frame)) {
+            Send(WebSocketCodec::Header(WebSocketCodec::Opcode::TEXT, compressed->size(), true));
+            Send(std::move(*compressed));
+            return;
+        }
+        Send(WebSocketCodec::Header(WebSocketCodec::Opcode::TEXT, frame->size()));
+        Send(frame);
+    }
+};
+
+// Upgrades on Poco's HTTP server, then plays on the detached socket right on
+// the handler's thread, so a browser player holds one thread and one poll
+// loop just like a native one
+class WebSocketUpgradeHandler final : public HTTPRequestHandler {
+public:
+    WebSocketUpgradeHandler(PlayerConnectionContext& ctx, bool deflate)
+        : Ctx(ctx)
+        , Deflate(deflate)
+    {
+    }
+
+    void handleRequest(HTTPServerRequest& request, HTTPServerResponse& response) override {
+        const String none;
+        const auto& key = request.get("Sec-WebSocket-Key", none);
+        if (request.getMethod() != HTTPRequest::HTTP_GET || !request.hasToken("Connection", "upgrade")
+            || Poco::icompare(request.get("Upgrade", none), "websocket") != 0 || key.empty()) {
+            Reject(response, HTTPResponse::HTTP_BAD_REQUEST, "Expected a WebSocket upgrade\n");
+            return;
+        }
+        if (request.get("Sec-WebSocket-Version", none) != "13") {
+            response.set("Sec-WebSocket-Version", "13");
+            Reject(response, HTTPResponse::HTTP_UPGRADE_REQUIRED, "Unsupported WebSocket version\n");
+            return;
+        }
+        // Browsers connect straight to this process even in cluster mode
+        if (!AdmitPlayer(Ctx, request.clientAddress().host(), AdmissionControl::Kind::PLAYER)) {
+            Reject(response, HTTPResponse::HTTP_SERVICE_UNAVAILABLE, "Server is busy\n");
+            return;
+        }
+
+        const bool deflate = Deflate && WebSocketCodec::OffersDeflate(request.get("Sec-WebSocket-Extensions", none));
+        StreamSocket socket;
+        try {
+            response.setStatusAndReason(HTTPResponse::HTTP_SWITCHING_PROTOCOLS);
+            response.set("Upgrade", "websocket");
+            response.set("Connection", "Upgrade");
+            response.set("Sec-WebSocket-Accept", WebSocketCodec::AcceptKey(key));
+            if (deflate) {
+                response.set("Sec-WebSocket-Extensions", String(WebSocketCodec::DEFLATE_EXTENSION));
+            }
+            response.setContentLength(HTTPResponse::UNKNOWN_CONTENT_LENGTH);
+            response.send().flush();
+            socket = static_cast<HTTPServerRequestImpl&>(request).detachSocket();
+        } catch (...) {
+            // No connection took the slot over yet
+            Ctx.ActiveConnections.fetch_sub(1);
+            throw;
+        }
+        WebSocketPlayerConnection(socket, Ctx, deflate).run();
+    }
+
+private:
+    PlayerConnectionContext& Ctx;
+    const bool Deflate;
+
+private:
+    static void Reject(HTTPServerResponse& response, HTTPResponse::HTTPStatus status, const String& body) {
+        response.setStatusAndReason(status);
+        response.setKeepAlive(false);
+        response.setContentType("text/plain; charset=utf-8");
+        response.setContentLength(static_cast<long>(body.size()));
+        response.sendBuffer(body.data(), body.size());
+    }
+};
+
+class WebSocketUpgradeHandlerFactory final : public HTTPRequestHandlerFactory {
+public:
+    WebSocketUpgradeHandlerFactory(PlayerConnectionContext& ctx, bool deflate)
+        : Ctx(ctx)
+        , Deflate(deflate)
+    {
+    }
+
+    HTTPRequestHandler* createRequestHandler(const HTTPServerRequest&) override {
+        return new WebSocketUpgradeHandler(Ctx, Deflate);
+    }
+
+private:
+    PlayerConnectionContext& Ctx;
+    const bool Deflate;
+};
+
+class PlayerConnectionManager final : public IPlayerConnectionManager {
+public:
+    PlayerConnectionManager(const ServerConfig& config, const PlayerServices& services)
+        : Ctx({services, {config.OutputLowWatermark, config.OutputHighWatermark},
+               ActiveConnections, IsStopping, config.MaxPlayerConnections,
+               config.WorkerIndex ? AdmissionControl::Kind::ROUTED_PLAYER : AdmissionControl::Kind::PLAYER})
+        , PlayerThreads("players", 1, PlayerThreadCount(config))
+        , Server(new PlayerConnectionFactory<PlayerConnection>(Ctx), PlayerThreads, ListenForPlayers(config),
+                 CreateParams(config))
+    {
+        Log().Info() << "Player server is listening for connections on " << Server.socket().address().toString();
+        Server.setConnectionFilter(new PlayerConnectionFilter(Ctx));
+        if (config.WebSocketPort) {
+            WebSocketServer = MakeHolder<HTTPServer>(new WebSocketUpgradeHandlerFactory(Ctx, config.WebSocketDeflate),
+                                                     PlayerThreads, ServerSocket(*config.WebSocketPort),
+                                                     CreateWebSocketParams(config));
+            Log().Info() << "WebSocket gateway is listening for connections on port " << *config.WebSocketPort;
+        }
+        services.Admission.AddQueueDepthSource([this]() {
+            return static_cast<size_t>(Server.queuedConnections()
+                                       + (WebSocketServer ? WebSocketServer->queuedConnections() : 0));
+        });
+    }
+
+    ~PlayerConnectionManager() {
+        OnTerminate();
+    }
+
+    void Start() override {
+        Server.start();
+        if (WebSocketServer) {
+            WebSocketServer->start();
+        }
+        Log().Info() << "Player server started";
+    }
+
+    void OnTerminate() override {
+        IsStopping = true;
+        Server.stop();
+        if (WebSocketServer) {
+            WebSocketServer->stop();
+        }
+    }
+
+private:
+    std::atomic<u32> ActiveConnections = {0};
+    std::atomic<bool> IsStopping = {false};
+    PlayerConnectionContext Ctx;
+
+    // A player holds its thread for the whole connection, on Poco's default
+    // pool they would run out of threads at 16 and starve admin and metrics.
+    // Native and browser players share it.
+    Poco::ThreadPool PlayerThreads;
+    TCPServer Server;
+    Holder<HTTPServer> WebSocketServer;
+
+private:
+    // Both servers may run up to max_player_connections threads each, idle
+    // ones linger a while after their player left. Admission is one budget
+    // for both: every connection holds a slot of the shared ActiveConnections.
+    static int PlayerThreadCount(const ServerConfig& config) {
+        const int perServer = std::max<int>(1, config.MaxPlayerConnections);
+        return config.WebSocketPort ? 2 * perServer : perServer;
+    }
+
+    static TCPServerParams::Ptr CreateParams(const ServerConfig& config) {
+        TCPServerParams::Ptr params = new TCPServerParams();
+        params->setMaxThreads(config.MaxPlayerConnections);
+        params->setMaxQueued(config.MaxPlayerConnections);
+        return params;
+    }
+
+    // A thread per connection as for native players, the handshake is the
+    // only plain HTTP request and must come at once
+    static HTTPServerParams::Ptr CreateWebSocketParams(const ServerConfig& config) {
+        HTTPServerParams::Ptr params = new HTTPServerParams();
+        params->setMaxThreads(config.MaxPlayerConnections);
+        params->setMaxQueued(config.MaxPlayerConnections);
+        params->setKeepAlive(false);
+        params->setTimeout(Poco::Timespan(WEBSOCKET_HANDSHAKE_TIMEOUT_US));
+        return params;
+    }
+};
+
+Holder<IPlayerConnectionManager> IPlayerConnectionManager::Create(const ServerConfig& config,
+                                                                  const PlayerServices& services) {
+    return MakeHolder<PlayerConnectionManager>(config, services);
+}
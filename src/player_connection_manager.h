@@ -1,15 +1,31 @@
 #pragma once
 
+#include "admission_control.h"
+#include "game/leaderboard.h"
+#include "game/matchmaker.h"
+#include "game/session_registry.h"
+#include "game/spectator_hub.h"
 #include "server_config.h"
 #include "termination.h"
+#include "udp_transport.h"
 #include "util/holder.h"
 
+struct PlayerServices {
+    Leaderboard& Board;
+    SessionRegistry& Sessions;
+    SpectatorHub& Spectators;
+    Matchmaker& Lobby;
+    AdmissionControl& Admission;
+    // Null unless udp_port is configured
+    IUdpMoveTransport* Udp;
+};
+
 class IPlayerConnectionManager : public ITerminationListener {
 public:
-    static Holder<IPlayerConnectionManager> Create(const ServerConfig& config);
+    static Holder<IPlayerConnectionManager> Create(const ServerConfig& config, const PlayerServices& services);
 
 public:
     virtual ~IPlayerConnectionManager() = default;
 
-    
+    virtual void Start() = 0;
 };
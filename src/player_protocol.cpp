@@ -0,0 +1,95 @@
+#include "player_protocol.h"
+
+#include "util/counters.h"
+
+#include <sstream>
+
+namespace {
+    StringView ToString(Field::ActionType type) {
+        switch (type) {
+            case Field::ActionType::NEW_CELLS_OPEN: return "OPENED";
+            case Field::ActionType::EXPLODE: return "EXPLODE";
+            case Field::ActionType::CELL_IS_ALREADY_OPEN: return "ALREADY_OPEN";
+            case Field::ActionType::CELL_HAS_FLAG: return "HAS_FLAG";
+            case Field::ActionType::FLAG_PLACED: return "FLAG_PLACED";
+            case Field::ActionType::FLAG_REMOVED: return "FLAG_REMOVED";
+            case Field::ActionType::REJECTED: return "REJECTED";
+        }
+        return "UNKNOWN";
+    }
+
+    String RejectedAnswer(Field::Error reason) {
+        Counters().Add(ServerCounter::MOVES_REJECTED);
+        return ErrorAnswer(Describe(reason));
+    }
+
+    String OpenAnswer(const GameSession::OpenCellOutcome& outcome, Leaderboard& board) {
+        std::ostringstream answer;
+        answer << ToString(outcome.Result.Type);
+        for (const auto& cell : outcome.Result.NewOpenCells) {
+            answer << ' ' << u32(cell.X) << ',' << u32(cell.Y) << ',' << u32(cell.MinesAround);
+        }
+        answer << '\n';
+
+        if (outcome.Completion && outcome.Completion->Won) {
+            const auto& completion = *outcome.Completion;
+            answer << "WIN " << completion.DurationMs;
+            if (IsRanked(completion.Level)) {
+                answer << " RANK " << ToString(completion.Level) << ' '
+                       << board.Rank(completion.Level, completion.DurationMs);
+            }
+            answer << '\n';
+        }
+        return answer.str();
+    }
+}
+
+Maybe<u8> ParseCoordinate(StringView word) {
+    const auto value = ParseUnsigned(word);
+    if (!value || *value > UINT8_MAX) {
+        return Nothing<u8>();
+    }
+    return static_cast<u8>(*value);
+}
+
+Maybe<Move> ParseMove(const std::vector<StringView>& words) {
+    if (words.size() != 3) {
+        return Nothing<Move>();
+    }
+    const auto x = ParseCoordinate(words[1]);
+    const auto y = ParseCoordinate(words[2]);
+    if (!x || !y) {
+        return Nothing<Move>();
+    }
+    if (words[0] == "OPEN") {
+        return Move{MoveKind::OPEN, *x, *y};
+    }
+    if (words[0] == "FLAG") {
+        return Move{MoveKind::FLAG, *x, *y};
+    }
+    return Nothing<Move>();
+}
+
+String ErrorAnswer(StringView message) {
+    constexpr StringView PREFIX = "ERROR ";
+    String answer;
+    answer.reserve(PREFIX.size() + message.size() + 1);
+    answer.append(PREFIX).append(message).push_back('\n');
+    return answer;
+}
+
+String ApplyMove(GameSession& session, const Move& move, const String& player, Leaderboard& board) {
+    if (move.Kind == MoveKind::OPEN) {
+        const auto outcome = session.OpenCell(move.X, move.Y, player);
+        if (outcome.Result.Type == Field::ActionType::REJECTED) {
+            return RejectedAnswer(outcome.Result.Reason);
+        }
+        return OpenAnswer(outcome, board);
+    }
+
+    const auto result = session.PlaceFlag(move.X, move.Y);
+    if (result.Type == Field::ActionType::REJECTED) {
+        return RejectedAnswer(result.Reason);
+    }
+    return String(ToString(result.Type)) + "\n";
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "game/game_session.h"
+#include "game/leaderboard.h"
+#include "types.h"
+#include "util/maybe.h"
+#include "util/string.h"
+
+// Move handling shared by every player transport, TCP lines and UDP
+// datagrams give the same answers for the same moves.
+
+enum class MoveKind : u8 {
+    OPEN,
+    FLAG
+};
+
+struct Move {
+    MoveKind Kind = MoveKind::OPEN;
+    u8 X = 0;
+    u8 Y = 0;
+};
+
+Maybe<u8> ParseCoordinate(StringView word);
+// "OPEN <x> <y>" or "FLAG <x> <y>" split into words
+Maybe<Move> ParseMove(const std::vector<StringView>& words);
+
+// Moves answer errors from static text, a flood of bad moves costs as
+// much as a flood of good ones: no throw and a single allocation
+String ErrorAnswer(StringView message);
+
+String ApplyMove(GameSession& session, const Move& move, const String& player, Leaderboard& board);
@@ -0,0 +1,108 @@
+#include "poll_wakeup.h"
+
+#include "types.h"
+
+#include <Poco/Exception.h>
+#include <Poco/Net/SocketAddress.h>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+using namespace Poco::Net;
+
+#if defined(__linux__)
+
+PollWakeup::PollWakeup()
+    : Fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+    if (Fd < 0) {
+        throw Poco::IOException("Cannot create eventfd");
+    }
+}
+
+PollWakeup::~PollWakeup() {
+    close(Fd);
+}
+
+void PollWakeup::Signal() {
+    const u64 one = 1;
+    // Only fails when the counter is about to overflow, it is signalled then anyway
+    static_cast<void>(write(Fd, &one, sizeof(one)));
+}
+
+bool PollWakeup::Poll(Socket& socket, const Poco::Timespan& timeout, int mode) {
+    pollfd fds[2] = {};
+    fds[0].fd = socket.sockfd();
+    fds[0].events = static_cast<short>(((mode & Socket::SELECT_READ) ? POLLIN : 0)
+                                       | ((mode & Socket::SELECT_WRITE) ? POLLOUT : 0));
+    fds[1].fd = Fd;
+    fds[1].events = POLLIN;
+    const int result = poll(fds, 2, static_cast<int>(timeout.totalMilliseconds()));
+    if (result < 0) {
+        if (errno == EINTR) {
+            return false;
+        }
+        throw Poco::IOException("poll failed");
+    }
+    if (fds[1].revents & POLLIN) {
+        u64 signals = 0;
+        static_cast<void>(read(Fd, &signals, sizeof(signals)));
+    }
+    return fds[0].revents != 0;
+}
+
+#else
+
+PollWakeup::PollWakeup()
+    : Receiver(SocketAddress("127.0.0.1", 0))
+{
+    Receiver.setBlocking(false);
+    Sender.setBlocking(false);
+}
+
+PollWakeup::~PollWakeup() = default;
+
+void PollWakeup::Signal() {
+    const char byte = 0;
+    try {
+        Sender.sendTo(&byte, 1, Receiver.address());
+    } catch (Poco::Exception&) {
+        // The receive buffer is full of signals already
+    }
+}
+
+bool PollWakeup::Poll(Socket& socket, const Poco::Timespan& timeout, int mode) {
+    Socket::SocketList readable = {Receiver};
+    Socket::SocketList writable;
+    Socket::SocketList failed = {socket};
+    if (mode & Socket::SELECT_READ) {
+        readable.push_back(socket);
+    }
+    if (mode & Socket::SELECT_WRITE) {
+        writable.push_back(socket);
+    }
+    Socket::select(readable, writable, failed, timeout);
+
+    bool isSignalled = false;
+    bool isReady = !writable.empty() || !failed.empty();
+    for (const auto& ready : readable) {
+        if (ready == Receiver) {
+            isSignalled = true;
+        } else {
+            isReady = true;
+        }
+    }
+    if (isSignalled) {
+        char buffer[64];
+        SocketAddress sender;
+        while (Receiver.available() > 0 && Receiver.receiveFrom(buffer, sizeof(buffer), sender) > 0) {
+        }
+    }
+    return isReady;
+}
+
+#endif
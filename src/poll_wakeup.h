@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Poco/Net/Socket.h>
+#include <Poco/Timespan.h>
+
+#if !defined(__linux__)
+#include <Poco/Net/DatagramSocket.h>
+#endif
+
+// Lets other threads cut a connection's socket poll short, so work they
+// hand over is picked up at once without polling on a short timeout. An
+// eventfd on Linux, a loopback datagram socket elsewhere.
+class PollWakeup final {
+public:
+    PollWakeup();
+    ~PollWakeup();
+
+    // Any thread
+    void Signal();
+
+    // Socket::poll which also returns once Signal is called, the signal is
+    // consumed. True when the socket itself is ready.
+    bool Poll(Poco::Net::Socket& socket, const Poco::Timespan& timeout, int mode);
+
+public:
+    PollWakeup(const PollWakeup&) = delete;
+    PollWakeup& operator=(const PollWakeup&) = delete;
+
+private:
+#if defined(__linux__)
+    int Fd = -1;
+#else
+    Poco::Net::DatagramSocket Receiver;
+    Poco::Net::DatagramSocket Sender;
+#endif
+};
@@ -7,7 +7,21 @@
 #include "types.h"
 #include "util/log.h"
 
-ServerConfig ReadConfig(const String& path) {
+namespace {
+    // Workers get the ports right after the router's and their own files
+    u16 WorkerPort(u16 port, const Maybe<u16>& workerIndex) {
+        return workerIndex ? static_cast<u16>(port + 1 + *workerIndex) : port;
+    }
+
+    Maybe<String> WorkerPath(const Maybe<String>& path, const Maybe<u16>& workerIndex) {
+        if (!path || !workerIndex) {
+            return path;
+        }
+        return *path + "." + std::to_string(*workerIndex);
+    }
+}
+
+ServerConfig ReadConfig(const String& path, const Maybe<u16>& workerIndex, const String& executablePath) {
     try {
         std::ifstream configStream(path);
         if (!configStream.is_open()) {
@@ -18,9 +32,47 @@ ServerConfig ReadConfig(const String& path) {
         auto config = parser.parse(configStream).extract<Poco::JSON::Object::Ptr>();
         return {
             /*GamePort =*/config->getValue<u16>("game_port"),
-            /*AdminPort =*/config->getValue<u16>("admin_port"),
+            /*AdminPort =*/WorkerPort(config->getValue<u16>("admin_port"), workerIndex),
             /*MaxPlayerConnections =*/config->getValue<u16>("max_player_connections"),
-            /*LogPath =*/config->has("log_path") ? config->getValue<String>("log_path") : Nothing<String>()
+            /*LogPath =*/WorkerPath(config->has("log_path") ? config->getValue<String>("log_path") : Nothing<String>(),
+                                    workerIndex),
+            /*MetricsPort =*/config->has("metrics_port")
+                ? WorkerPort(config->getValue<u16>("metrics_port"), workerIndex)
+                : Nothing<u16>(),
+            /*LeaderboardPath =*/WorkerPath(config->has("leaderboard_path")
+                                                ? config->getValue<String>("leaderboard_path")
+                                                : Nothing<String>(),
+                                            workerIndex),
+            /*LeaderboardSnapshotIntervalSec =*/config->has("leaderboard_snapshot_interval_sec")
+                ? config->getValue<u32>("leaderboard_snapshot_interval_sec")
+                : 60,
+            /*SpectatorTickMs =*/config->has("spectator_tick_ms") ? config->getValue<u32>("spectator_tick_ms") : 50,
+            /*OutputLowWatermark =*/config->has("output_low_watermark") ? config->getValue<u32>("output_low_watermark") : 64 * 1024,
+            /*OutputHighWatermark =*/config->has("output_high_watermark") ? config->getValue<u32>("output_high_watermark") : 256 * 1024,
+            /*AdmissionConnectionsPerSec =*/config->has("admission_connections_per_sec")
+                ? config->getValue<f64>("admission_connections_per_sec")
+                : 5,
+            /*AdmissionBurst =*/config->has("admission_burst") ? config->getValue<f64>("admission_burst") : 20,
+            /*ShedMoveLatencyUs =*/config->has("shed_move_latency_us") ? config->getValue<u32>("shed_move_latency_us") : 50 * 1000,
+            /*ShedQueueDepth =*/config->has("shed_queue_depth") ? config->getValue<u32>("shed_queue_depth") : 16,
+            /*MatchSize =*/config->has("match_size") ? config->getValue<u32>("match_size") : 2,
+            /*MatchWaitMs =*/config->has("match_wait_ms") ? config->getValue<u32>("match_wait_ms") : 5000,
+            /*MatchmakingQueueCapacity =*/config->has("matchmaking_queue_capacity")
+                ? config->getValue<u32>("matchmaking_queue_capacity")
+                : 4096,
+            /*UdpPort =*/config->has("udp_port")
+                ? WorkerPort(config->getValue<u16>("udp_port"), workerIndex)
+                : Nothing<u16>(),
+            /*UdpDropRate =*/config->has("udp_drop_rate") ? config->getValue<f64>("udp_drop_rate") : 0,
+            /*WebSocketPort =*/config->has("websocket_port")
+                ? WorkerPort(config->getValue<u16>("websocket_port"), workerIndex)
+                : Nothing<u16>(),
+            /*WebSocketDeflate =*/config->has("websocket_deflate") ? config->getValue<bool>("websocket_deflate") : true,
+            /*WorkerCount =*/config->has("worker_count") ? config->getValue<u16>("worker_count") : u16(0),
+            /*WorkerIndex =*/workerIndex,
+            /*ClusterSocketDir =*/config->has("cluster_socket_dir") ? config->getValue<String>("cluster_socket_dir") : Nothing<String>(),
+            /*ConfigPath =*/path,
+            /*ExecutablePath =*/executablePath
         };
     } catch (const Poco::JSON::JSONException& exception) {
         std::stringstream reason;
@@ -30,8 +82,8 @@ ServerConfig ReadConfig(const String& path) {
 }
 
 ServerConfig ParseArguments(int argc, const char** argv) {
-    if (argc != 3) {
-        throw std::runtime_error("provide exactly 1 required argument: config path");
+    if (argc != 3 && argc != 5) {
+        throw std::runtime_error("expected arguments: --config <path> [--worker <index>]");
     }
 
     String argName = argv[1];
@@ -41,7 +93,25 @@ ServerConfig ParseArguments(int argc, const char** argv) {
         throw std::runtime_error(reason.str());
     }
 
-    const auto config = ReadConfig(argv[2]);
+    // Only a cluster router passes --worker, when it launches its workers
+    Maybe<u16> workerIndex;
+    if (argc == 5) {
+        const auto index = ParseUnsigned(argv[4]);
+        if (String(argv[3]) != "--worker" || !index || *index > UINT16_MAX) {
+            std::stringstream reason;
+            reason << "expected argument: --worker <index> but got: " << argv[3] << ' ' << argv[4];
+            throw std::runtime_error(reason.str());
+        }
+        workerIndex = static_cast<u16>(*index);
+    }
+
+    const auto config = ReadConfig(argv[2], workerIndex, argv[0]);
+    if (config.WorkerIndex && *config.WorkerIndex >= config.WorkerCount) {
+        throw std::runtime_error("worker index is out of worker_count range");
+    }
+    if (config.OutputHighWatermark == 0 || config.OutputLowWatermark > config.OutputHighWatermark) {
+        throw std::runtime_error("output_high_watermark should be positive and not below output_low_watermark");
+    }
     if (config.LogPath) {
         Logger::SetLogFile(*config.LogPath);
     }
@@ -9,6 +9,34 @@ struct ServerConfig {
     const u16 AdminPort;
     const u16 MaxPlayerConnections;
     const Maybe<String> LogPath;
+    const Maybe<u16> MetricsPort;
+    const Maybe<String> LeaderboardPath;
+    const u32 LeaderboardSnapshotIntervalSec;
+    const u32 SpectatorTickMs;
+    const u32 OutputLowWatermark;
+    const u32 OutputHighWatermark;
+    const f64 AdmissionConnectionsPerSec;
+    const f64 AdmissionBurst;
+    const u32 ShedMoveLatencyUs;
+    const u32 ShedQueueDepth;
+    const u32 MatchSize;
+    const u32 MatchWaitMs;
+    const u32 MatchmakingQueueCapacity;
+    const Maybe<u16> UdpPort;
+    // Share of datagrams the UDP transport throws away in each direction,
+    // for testing client retransmission over loopback
+    const f64 UdpDropRate;
+    const Maybe<u16> WebSocketPort;
+    const bool WebSocketDeflate;
+    // Zero runs a single process, otherwise this process routes players to
+    // WorkerCount worker processes it launches itself
+    const u16 WorkerCount;
+    // Set for worker processes only, ports and file paths above are
+    // already the worker's own
+    const Maybe<u16> WorkerIndex;
+    const Maybe<String> ClusterSocketDir;
+    const String ConfigPath;
+    const String ExecutablePath;
 };
 
 ServerConfig ParseArguments(int argc, const char** argv);
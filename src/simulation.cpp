@@ -0,0 +1,329 @@
+#include "simulation.h"
+
+#include "game/field.h"
+#include "util/latency.h"
+#include "util/maybe.h"
+#include "util/string.h"
+#include "util/work_stealing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr StringView SIMULATE_FLAG = "--simulate";
+
+    // splitmix64 finalizer: neighbouring seeds give unrelated boards, and
+    // the digest doesn't depend on the order games finish in
+    u64 Mix(u64 value) {
+        value += 0x9e3779b97f4a7c15ull;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        return value ^ (value >> 31);
+    }
+
+    StringView ToString(SimulatedPlayer player) {
+        switch (player) {
+            case SimulatedPlayer::RANDOM: return "random";
+            case SimulatedPlayer::GREEDY: return "greedy";
+        }
+        return "unknown";
+    }
+
+    Maybe<SimulatedPlayer> ParseSimulatedPlayer(StringView name) {
+        if (name == "random") {
+            return SimulatedPlayer::RANDOM;
+        }
+        if (name == "greedy") {
+            return SimulatedPlayer::GREEDY;
+        }
+        return Nothing<SimulatedPlayer>();
+    }
+
+    // One per worker and merged at the end, workers share nothing while playing
+    struct Tally {
+        u64 Games = 0;
+        u64 Wins = 0;
+        u64 Explosions = 0;
+        u64 Moves = 0;
+        u64 Guesses = 0;
+        u64 Digest = 0;
+        LatencySnapshot CascadeSizes;
+        LatencySnapshot FirstClickNs;
+        LatencySnapshot MovesPerGame;
+
+        void Merge(const Tally& other) {
+            Games += other.Games;
+            Wins += other.Wins;
+            Explosions += other.Explosions;
+            Moves += other.Moves;
+            Guesses += other.Guesses;
+            Digest += other.Digest;
+            CascadeSizes.Merge(other.CascadeSizes);
+            FirstClickNs.Merge(other.FirstClickNs);
+            MovesPerGame.Merge(other.MovesPerGame);
+        }
+    };
+
+    class SelfPlayGame {
+    public:
+        SelfPlayGame(const BoardParameters& board, u64 seed, SimulatedPlayer player, Tally& stats)
+            : Board(board.Width, board.Height, board.MineCount, static_cast<u32>(Mix(seed)))
+            , Seed(seed)
+            , Player(player)
+            , Random(Mix(~seed))
+            , Stats(stats)
+        {
+            Unknown.reserve(u32(board.Width) * board.Height);
+            for (u8 y = 0; y < board.Height; ++y) {
+                for (u8 x = 0; x < board.Width; ++x) {
+                    Unknown.push_back({x, y});
+                }
+            }
+        }
+
+        void Play() {
+            const auto start = Clock::now();
+            Guess();
+            Stats.FirstClickNs.Record(static_cast<u64>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count()));
+
+            while (!IsOver) {
+                if (Player == SimulatedPlayer::GREEDY && Deduce()) {
+                    continue;
+                }
+                Guess();
+            }
+
+            ++Stats.Games;
+            ++(Won ? Stats.Wins : Stats.Explosions);
+            Stats.Moves += Moves;
+            Stats.MovesPerGame.Record(Moves);
+            Stats.Digest += Mix(Seed ^ Mix((u64(Moves) << 1) | u64(Won)));
+        }
+
+    private:
+        struct Coordinates {
+            u8 X = 0;
+            u8 Y = 0;
+        };
+
+    private:
+        Field Board;
+        const u64 Seed;
+        const SimulatedPlayer Player;
+        // The standard distributions differ between library vendors, plain
+        // modulo keeps the games the same everywhere
+        std::mt19937_64 Random;
+        Tally& Stats;
+        // Candidates for a guess, cells opened by cascades are weeded out lazily
+        std::vector<Coordinates> Unknown;
+        std::vector<Coordinates> Closed;
+        bool IsOver = false;
+        bool Won = false;
+        u32 Moves = 0;
+
+    private:
+        void Open(u8 x, u8 y) {
+            const auto result = Board.OpenCell(x, y);
+            ++Moves;
+            if (result.Type == Field::ActionType::EXPLODE) {
+                IsOver = true;
+            } else if (result.Type == Field::ActionType::NEW_CELLS_OPEN) {
+                Stats.CascadeSizes.Record(result.NewOpenCells.size());
+                if (Board.IsCleared()) {
+                    IsOver = Won = true;
+                }
+            }
+        }
+
+        void Guess() {
+            ++Stats.Guesses;
+            for (;;) {
+                const size_t index = Random() % Unknown.size();
+                const auto cell = Unknown[index];
+                const auto view = Board.View(cell.X, cell.Y);
+                std::swap(Unknown[index], Unknown.back());
+                Unknown.pop_back();
+                if (!view.IsOpen && !view.HasFlag) {
+                    Open(cell.X, cell.Y);
+                    return;
+                }
+            }
+        }
+
+        // One sweep of the two textbook rules: a number with as many flags
+        // around it as mines has its other neighbours safe, a number with as
+        // many closed neighbours as mines has them all mined
+        bool Deduce() {
+            bool progress = false;
+            for (u8 y = 0; y < Board.GetHeight() && !IsOver; ++y) {
+                for (u8 x = 0; x < Board.GetWidth() && !IsOver; ++x) {
+                    const auto view = Board.View(x, y);
+                    if (!view.IsOpen || view.MinesAround == 0) {
+                        continue;
+                    }
+                    Closed.clear();
+                    u32 flags = 0;
+                    ForEachNeighbour(x, y, [this, &flags](u8 neighbourX, u8 neighbourY) {
+                        const auto neighbour = Board.View(neighbourX, neighbourY);
+                        if (neighbour.HasFlag) {
+                            ++flags;
+                        } else if (!neighbour.IsOpen) {
+                            Closed.push_back({neighbourX, neighbourY});
+                        }
+                    });
+                    if (Closed.empty()) {
+                        continue;
+                    }
+                    if (flags == view.MinesAround) {
+                        for (const auto& cell : Closed) {
+                            if (!IsOver && !Board.View(cell.X, cell.Y).IsOpen) {
+                                Open(cell.X, cell.Y);
+                            }
+                        }
+                        progress = true;
+                    } else if (flags + Closed.size() == view.MinesAround) {
+                        for (const auto& cell : Closed) {
+                            Board.PlaceFlag(cell.X, cell.Y);
+                            ++Moves;
+                        }
+                        progress = true;
+                    }
+                }
+            }
+            return progress;
+        }
+
+        template <typename F>
+        void ForEachNeighbour(u8 x, u8 y, F&& callback) const {
+            for (int dy = -1; dy <= 1; ++dy) {
+                for (int dx = -1; dx <= 1; ++dx) {
+                    const int neighbourX = x + dx;
+                    const int neighbourY = y + dy;
+                    if ((dx != 0 || dy != 0)
+                        && neighbourX >= 0 && neighbourX < Board.GetWidth()
+                        && neighbourY >= 0 && neighbourY < Board.GetHeight()) {
+                        callback(u8(neighbourX), u8(neighbourY));
+                    }
+                }
+            }
+        }
+    };
+
+    f64 Percent(u64 part, u64 total) {
+        return total == 0 ? 0 : 100.0 * part / total;
+    }
+
+    void PrintDistribution(std::ostream& out, StringView name, const LatencySnapshot& values,
+                           f64 divisor, StringView unit) {
+        out << std::left << std::setw(16) << name << std::right
+            << "mean " << values.Mean() / divisor
+            << "  p50 " << values.Percentile(50) / divisor
+            << "  p90 " << values.Percentile(90) / divisor
+            << "  p99 " << values.Percentile(99) / divisor
+            << "  max " << values.Max / divisor
+            << ' ' << unit << '\n';
+    }
+}
+
+bool IsSimulation(int argc, const char** argv) {
+    return argc > 1 && argv[1] == SIMULATE_FLAG;
+}
+
+SimulationConfig ParseSimulationArguments(int argc, const char** argv) {
+    constexpr StringView USAGE = "usage: --simulate <beginner|intermediate|expert> <games> "
+                                 "[--player random|greedy] [--seed <first seed>] [--threads <count>]";
+    const auto fail = [&USAGE](const String& reason) {
+        std::stringstream message;
+        message << reason << ", " << USAGE;
+        throw std::runtime_error(message.str());
+    };
+
+    if (argc < 4 || argc % 2 != 0) {
+        fail("wrong number of arguments");
+    }
+
+    SimulationConfig config;
+    const auto level = ParseDifficulty(argv[2]);
+    if (!level || !IsRanked(*level)) {
+        fail("unknown difficulty: " + String(argv[2]));
+    }
+    config.Level = *level;
+    const auto games = ParseUnsigned64(argv[3]);
+    if (!games || *games == 0) {
+        fail("game count should be a positive number");
+    }
+    config.Games = *games;
+    config.Threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 4; i < argc; i += 2) {
+        const String name = argv[i];
+        const StringView value = argv[i + 1];
+        if (name == "--player") {
+            const auto player = ParseSimulatedPlayer(value);
+            if (!player) {
+                fail("unknown player: " + String(value));
+            }
+            config.Player = *player;
+        } else if (name == "--seed") {
+            const auto seed = ParseUnsigned64(value);
+            if (!seed) {
+                fail("seed should be a number");
+            }
+            config.FirstSeed = *seed;
+        } else if (name == "--threads") {
+            const auto threads = ParseUnsigned(value);
+            if (!threads || *threads == 0 || *threads > 1024) {
+                fail("thread count should be 1-1024");
+            }
+            config.Threads = static_cast<u32>(*threads);
+        } else {
+            fail("unknown argument: " + name);
+        }
+    }
+    return config;
+}
+
+int RunSimulation(const SimulationConfig& config) {
+    const auto board = *PresetBoard(config.Level);
+    std::vector<Tally> tallies(config.Threads);
+
+    const auto start = Clock::now();
+    WorkStealingRange::Run(config.Games, config.Threads, [&](size_t worker, u64 index) {
+        SelfPlayGame(board, config.FirstSeed + index, config.Player, tallies[worker]).Play();
+    });
+    const f64 elapsedSec = std::chrono::duration<f64>(Clock::now() - start).count();
+
+    Tally total;
+    for (const auto& tally : tallies) {
+        total.Merge(tally);
+    }
+
+    std::ostream& out = std::cout;
+    out << std::fixed << std::setprecision(2);
+    out << "Simulated " << total.Games << ' ' << ToString(config.Level) << " games, "
+        << ToString(config.Player) << " player, seeds " << config.FirstSeed << '-'
+        << config.FirstSeed + config.Games - 1 << ", " << config.Threads << " threads\n";
+    out << "Elapsed " << elapsedSec << " s, " << total.Games / elapsedSec << " games/s, "
+        << total.Moves / elapsedSec << " moves/s\n";
+    out << "Won " << total.Wins << " (" << Percent(total.Wins, total.Games) << "%), exploded "
+        << total.Explosions << " (" << Percent(total.Explosions, total.Games) << "%), "
+        << "guesses per game " << static_cast<f64>(total.Guesses) / total.Games << '\n';
+    PrintDistribution(out, "First click", total.FirstClickNs, 1000, "us");
+#if defined(MINESWEEPER_LATENCY_PROBES)
+    PrintDistribution(out, "Mine generation", Latency().Collect(LatencyProbe::FIELD_GENERATE_MINES), 1000, "us");
+#endif
+    PrintDistribution(out, "Cascade size", total.CascadeSizes, 1, "cells");
+    PrintDistribution(out, "Moves per game", total.MovesPerGame, 1, "moves");
+    out << "Digest " << std::hex << std::setw(16) << std::setfill('0') << total.Digest << std::dec << '\n';
+    return 0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "game/difficulty.h"
+#include "types.h"
+
+// Headless self-play straight against Field on every core, no sockets
+// involved. Game i of a run is played with seed FirstSeed + i, so a seed
+// range always gives the same games and the same digest on a given build,
+// whatever the thread count. Timings are the only part of the report which
+// differs between runs.
+enum class SimulatedPlayer : u8 {
+    // Opens a random unknown cell every move
+    RANDOM,
+    // Flags and opens what the open numbers prove, guesses only when stuck
+    GREEDY
+};
+
+struct SimulationConfig {
+    Difficulty Level = Difficulty::BEGINNER;
+    u64 Games = 0;
+    u64 FirstSeed = 0;
+    SimulatedPlayer Player = SimulatedPlayer::GREEDY;
+    u32 Threads = 0;
+};
+
+bool IsSimulation(int argc, const char** argv);
+// --simulate <beginner|intermediate|expert> <games>
+//     [--player random|greedy] [--seed <first seed>] [--threads <count>]
+SimulationConfig ParseSimulationArguments(int argc, const char** argv);
+// Prints the report to stdout and returns the process exit code
+int RunSimulation(const SimulationConfig& config);
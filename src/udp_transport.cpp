@@ -0,0 +1,340 @@
+#include "udp_transport.h"
+
+#include "player_protocol.h"
+#include "util/counters.h"
+#include "util/log.h"
+#include "util/maybe.h"
+
+#include <Poco/Net/DatagramSocket.h>
+#include <Poco/Net/SocketAddress.h>
+#include <Poco/Timespan.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+using namespace Poco::Net;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr size_t BATCH_SIZE = 32;
+    // Requests are a single short line, anything longer is garbage
+    constexpr size_t DATAGRAM_BYTES_MAX = 128;
+    constexpr long POLL_TIMEOUT_US = 250 * 1000;
+
+    struct Datagram {
+        SocketAddress Peer;
+        String Payload;
+    };
+}
+
+// Moves many datagrams per syscall with recvmmsg/sendmmsg on Linux, one by
+// one through Poco elsewhere. The socket must be non-blocking.
+class DatagramBatcher {
+public:
+    explicit DatagramBatcher(DatagramSocket& socket)
+        : Socket(socket)
+    {
+    }
+
+    // Appends up to BATCH_SIZE datagrams which are already queued
+    void Receive(std::vector<Datagram>& datagrams) {
+#if defined(__linux__)
+        for (size_t i = 0; i < BATCH_SIZE; ++i) {
+            Vectors[i] = {Buffers[i].data(), Buffers[i].size()};
+            Headers[i] = {};
+            Headers[i].msg_hdr.msg_name = &Addresses[i];
+            Headers[i].msg_hdr.msg_namelen = sizeof(Addresses[i]);
+            Headers[i].msg_hdr.msg_iov = &Vectors[i];
+            Headers[i].msg_hdr.msg_iovlen = 1;
+        }
+        const int count = recvmmsg(Socket.sockfd(), Headers.data(), BATCH_SIZE, MSG_DONTWAIT, nullptr);
+        if (count < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                Log().Error() << "recvmmsg failed with errno " << errno;
+            }
+            return;
+        }
+        for (int i = 0; i < count; ++i) {
+            const auto& header = Headers[i].msg_hdr;
+            if (header.msg_flags & MSG_TRUNC) {
+                continue;
+            }
+            datagrams.push_back({SocketAddress(reinterpret_cast<const sockaddr*>(&Addresses[i]), header.msg_namelen),
+                                 String(Buffers[i].data(), Headers[i].msg_len)});
+        }
+#else
+        for (size_t i = 0; i < BATCH_SIZE && Socket.available() > 0; ++i) {
+            SocketAddress peer;
+            const int size = Socket.receiveFrom(Buffer.data(), static_cast<int>(Buffer.size()), peer);
+            if (size < 0) {
+                break;
+            }
+            datagrams.push_back({peer, String(Buffer.data(), static_cast<size_t>(size))});
+        }
+#endif
+    }
+
+    // Best effort like UDP itself: what doesn't fit the socket buffer is
+    // dropped and the client resends
+    void Send(const std::vector<Datagram>& datagrams) {
+#if defined(__linux__)
+        for (size_t begin = 0; begin < datagrams.size(); begin += BATCH_SIZE) {
+            const size_t count = std::min(BATCH_SIZE, datagrams.size() - begin);
+            for (size_t i = 0; i < count; ++i) {
+                const auto& datagram = datagrams[begin + i];
+                Vectors[i] = {const_cast<char*>(datagram.Payload.data()), datagram.Payload.size()};
+                Headers[i] = {};
+                Headers[i].msg_hdr.msg_name = const_cast<void*>(static_cast<const void*>(datagram.Peer.addr()));
+                Headers[i].msg_hdr.msg_namelen = datagram.Peer.length();
+                Headers[i].msg_hdr.msg_iov = &Vectors[i];
+                Headers[i].msg_hdr.msg_iovlen = 1;
+            }
+            for (size_t sent = 0; sent < count;) {
+                const int result = sendmmsg(Socket.sockfd(), Headers.data() + sent,
+                                            static_cast<unsigned>(count - sent), MSG_DONTWAIT);
+                if (result <= 0) {
+                    break;
+                }
+                sent += static_cast<size_t>(result);
+            }
+        }
+#else
+        for (const auto& datagram : datagrams) {
+            try {
+                Socket.sendTo(datagram.Payload.data(), static_cast<int>(datagram.Payload.size()), datagram.Peer);
+            } catch (Poco::Exception&) {
+                // Same as a lost packet
+            }
+        }
+#endif
+    }
+
+private:
+    DatagramSocket& Socket;
+#if defined(__linux__)
+    std::array<mmsghdr, BATCH_SIZE> Headers;
+    std::array<iovec, BATCH_SIZE> Vectors;
+    std::array<sockaddr_storage, BATCH_SIZE> Addresses;
+    std::array<std::array<char, DATAGRAM_BYTES_MAX>, BATCH_SIZE> Buffers;
+#else
+    std::array<char, DATAGRAM_BYTES_MAX> Buffer;
+#endif
+};
+
+class UdpMoveTransport final : public IUdpMoveTransport {
+public:
+    UdpMoveTransport(const ServerConfig& config, Leaderboard& board)
+        : Board(board)
+        , DropRate(config.UdpDropRate)
+        , Port(*config.UdpPort)
+        , Socket(SocketAddress(Port), true)
+        , Batcher(Socket)
+        , Random(std::random_device()())
+        , TokenRandom(std::random_device()())
+    {
+        Socket.setBlocking(false);
+        Log().Info() << "UDP move transport is listening on port " << Port;
+        if (DropRate > 0) {
+            Log().Warn() << "UDP move transport drops " << DropRate * 100 << "% of datagrams on purpose";
+        }
+    }
+
+    ~UdpMoveTransport() {
+        OnTerminate();
+    }
+
+    void Start() override {
+        Receiver = std::thread([this]() { Run(); });
+    }
+
+    void OnTerminate() override {
+        IsStopping = true;
+        if (Receiver.joinable()) {
+            Receiver.join();
+        }
+    }
+
+    u16 GetPort() const override {
+        return Port;
+    }
+
+    u64 Bind(std::shared_ptr<GameSession> session, const String& player, const IPAddress& host) override {
+        auto binding = std::make_shared<Binding>(std::move(session), player, host);
+        std::lock_guard<std::mutex> lock(BindingsMutex);
+        u64 token = 0;
+        do {
+            token = TokenRandom();
+        } while (token == 0 || Bindings.count(token) > 0);
+        Bindings.emplace(token, std::move(binding));
+        return token;
+    }
+
+    void Unbind(u64 token) override {
+        std::lock_guard<std::mutex> lock(BindingsMutex);
+        Bindings.erase(token);
+    }
+
+private:
+    struct Reply {
+        u64 MoveId = 0;
+        String Answer;
+    };
+
+    // Everything but the map entry itself is only touched by the receiver thread
+    struct Binding {
+        const std::shared_ptr<GameSession> Session;
+        const String Player;
+        const IPAddress Host;
+        u64 HighestMoveId = 0;
+        std::array<Reply, REPLAY_WINDOW> Replies;
+        Clock::time_point ReplaySecondStart;
+        u32 ReplaysThisSecond = 0;
+
+        Binding(std::shared_ptr<GameSession> session, const String& player, const IPAddress& host)
+            : Session(std::move(session))
+            , Player(player)
+            , Host(host)
+        {
+        }
+    };
+
+private:
+    Leaderboard& Board;
+    const f64 DropRate;
+    const u16 Port;
+    DatagramSocket Socket;
+    DatagramBatcher Batcher;
+    std::mt19937 Random;
+
+    std::mutex BindingsMutex;
+    std::unordered_map<u64, std::shared_ptr<Binding>> Bindings;
+    std::mt19937_64 TokenRandom;
+
+    std::atomic<bool> IsStopping = {false};
+    std::thread Receiver;
+
+private:
+    void Run() {
+        std::vector<Datagram> incoming;
+        std::vector<Datagram> outgoing;
+        incoming.reserve(BATCH_SIZE);
+        outgoing.reserve(BATCH_SIZE);
+        while (!IsStopping.load()) {
+            try {
+                if (!Socket.poll(Poco::Timespan(POLL_TIMEOUT_US), Socket::SELECT_READ)) {
+                    continue;
+                }
+                incoming.clear();
+                outgoing.clear();
+                Batcher.Receive(incoming);
+                Counters().Add(ServerCounter::UDP_DATAGRAMS_RECEIVED, incoming.size());
+
+                // Loss is simulated both ways: a lost ack makes the client resend
+                // a move which was applied already
+                for (auto& datagram : incoming) {
+                    if (ShouldDrop()) {
+                        continue;
+                    }
+                    auto answer = OnDatagram(datagram.Peer, datagram.Payload);
+                    if (answer && !ShouldDrop()) {
+                        outgoing.push_back({datagram.Peer, std::move(*answer)});
+                    }
+                }
+                Batcher.Send(outgoing);
+                Counters().Add(ServerCounter::UDP_DATAGRAMS_SENT, outgoing.size());
+            } catch (Poco::Exception& ex) {
+                Log().Error() << "UDP move transport error: " << ex.displayText();
+            }
+        }
+    }
+
+    Maybe<String> OnDatagram(const SocketAddress& peer, StringView payload) {
+        const auto words = SplitWords(payload);
+        if (words.size() != 5) {
+            return Nothing<String>();
+        }
+        const auto token = ParseUnsigned64(words[0]);
+        const auto moveId = ParseUnsigned64(words[1]);
+        const auto move = ParseMove({words.begin() + 2, words.end()});
+        if (!token || !moveId || *moveId == 0 || !move) {
+            return Nothing<String>();
+        }
+        const auto binding = Find(*token);
+        if (!binding || peer.host() != binding->Host) {
+            Counters().Add(ServerCounter::UDP_DATAGRAMS_REJECTED);
+            return Nothing<String>();
+        }
+        auto answer = Answer(*binding, *moveId, *move);
+        if (!answer) {
+            Counters().Add(ServerCounter::UDP_DATAGRAMS_REJECTED);
+            return Nothing<String>();
+        }
+        return "ACK " + std::to_string(*moveId) + " " + *answer;
+    }
+
+    // Nothing when the move is a replay over the per-second budget, the
+    // client resends it anyway
+    Maybe<String> Answer(Binding& binding, u64 moveId, const Move& move) {
+        auto& reply = binding.Replies[moveId % REPLAY_WINDOW];
+        if (reply.MoveId == moveId) {
+            if (!TakeReplay(binding)) {
+                return Nothing<String>();
+            }
+            Counters().Add(ServerCounter::UDP_MOVES_REPLAYED);
+            return reply.Answer;
+        }
+        // Its slot was reused, nobody knows any more whether it was applied
+        if (binding.HighestMoveId >= REPLAY_WINDOW && moveId <= binding.HighestMoveId - REPLAY_WINDOW) {
+            return ErrorAnswer("Move is too old");
+        }
+
+        reply.MoveId = moveId;
+        reply.Answer = ApplyMove(*binding.Session, move, binding.Player, Board);
+        binding.HighestMoveId = std::max(binding.HighestMoveId, moveId);
+        return reply.Answer;
+    }
+
+    bool TakeReplay(Binding& binding) {
+        const auto now = Clock::now();
+        if (now - binding.ReplaySecondStart >= std::chrono::seconds(1)) {
+            binding.ReplaySecondStart = now;
+            binding.ReplaysThisSecond = 0;
+        }
+        if (binding.ReplaysThisSecond >= REPLAYS_PER_SECOND) {
+            return false;
+        }
+        ++binding.ReplaysThisSecond;
+        return true;
+    }
+
+    std::shared_ptr<Binding> Find(u64 token) {
+        std::lock_guard<std::mutex> lock(BindingsMutex);
+        const auto it = Bindings.find(token);
+        return it == Bindings.end() ? nullptr : it->second;
+    }
+
+    bool ShouldDrop() {
+        return DropRate > 0 && std::uniform_real_distribution<f64>(0, 1)(Random) < DropRate;
+    }
+};
+
+Holder<IUdpMoveTransport> IUdpMoveTransport::Create(const ServerConfig& config, Leaderboard& board) {
+    if (!config.UdpPort) {
+        return nullptr;
+    }
+    return MakeHolder<UdpMoveTransport>(config, board);
+}
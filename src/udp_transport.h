@@ -0,0 +1,47 @@
+#pragma once
+
+#include "game/game_session.h"
+#include "game/leaderboard.h"
+#include "server_config.h"
+#include "termination.h"
+#include "types.h"
+#include "util/holder.h"
+#include "util/string.h"
+
+#include <Poco/Net/IPAddress.h>
+
+#include <memory>
+
+// Optional low-latency path for moves, free of TCP head-of-line blocking.
+// A player asks for it on the TCP connection with UDP and gets a token,
+// datagrams carrying the token from the host of that connection are applied
+// to the session the connection was in at that moment.
+//
+//   request: <token> <move id> OPEN|FLAG <x> <y>
+//   answer:  ACK <move id> <the answer TCP would give>
+//
+// Clients number their moves and resend a move until it is acked. The
+// answers to the last REPLAY_WINDOW moves are kept, so a resent move is
+// answered again instead of being applied twice, at most
+// REPLAYS_PER_SECOND times a second per token. Datagrams which don't parse,
+// carry an unknown token or come from another host get no answer at all,
+// so a token can't be used to bounce answers at a spoofed address.
+class IUdpMoveTransport : public ITerminationListener {
+public:
+    static constexpr u64 REPLAY_WINDOW = 64;
+    static constexpr u32 REPLAYS_PER_SECOND = 16;
+
+    // Returns nullptr when udp_port is not configured
+    static Holder<IUdpMoveTransport> Create(const ServerConfig& config, Leaderboard& board);
+
+public:
+    virtual ~IUdpMoveTransport() = default;
+
+    virtual void Start() = 0;
+    virtual u16 GetPort() const = 0;
+
+    // Only datagrams from `host` are accepted for the token
+    virtual u64 Bind(std::shared_ptr<GameSession> session, const String& player,
+                     const Poco::Net::IPAddress& host) = 0;
+    virtual void Unbind(u64 token) = 0;
+};
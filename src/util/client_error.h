@@ -1,3 +1,5 @@
+#pragma once
+
 #include <exception>
 
 #include "string.h"
@@ -13,10 +15,10 @@ public:
         return Reason;
     }
 
+    const char* what() const noexcept override {
+        return Reason.c_str();
+    }
+
 private:
     String Reason;
-
-    const char* what() const override {
-        return nullptr;
-    }
 };
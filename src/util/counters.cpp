@@ -0,0 +1,42 @@
+#include "counters.h"
+
+StringView ToString(ServerCounter counter) {
+    switch (counter) {
+        case ServerCounter::ADMIN_CONNECTIONS_ACCEPTED: return "admin_connections_accepted";
+        case ServerCounter::ADMIN_CONNECTIONS_REJECTED: return "admin_connections_rejected";
+        case ServerCounter::ADMIN_COMMANDS: return "admin_commands";
+        case ServerCounter::MOVES_REJECTED: return "moves_rejected";
+        case ServerCounter::PLAYER_CONNECTIONS_ACCEPTED: return "player_connections_accepted";
+        case ServerCounter::PLAYER_CONNECTIONS_REJECTED: return "player_connections_rejected";
+        case ServerCounter::ADMISSION_RATE_LIMITED: return "admission_rate_limited";
+        case ServerCounter::ADMISSION_SHED: return "admission_shed";
+        case ServerCounter::UDP_DATAGRAMS_RECEIVED: return "udp_datagrams_received";
+        case ServerCounter::UDP_DATAGRAMS_SENT: return "udp_datagrams_sent";
+        case ServerCounter::UDP_MOVES_REPLAYED: return "udp_moves_replayed";
+        case ServerCounter::UDP_DATAGRAMS_REJECTED: return "udp_datagrams_rejected";
+        case ServerCounter::LOG_RECORDS: return "log_records";
+        case ServerCounter::METRICS_REQUESTS: return "metrics_requests";
+        case ServerCounter::COUNT: break;
+    }
+    return "unknown";
+}
+
+StringView ToString(ServerGauge gauge) {
+    switch (gauge) {
+        case ServerGauge::MATCHMAKING_QUEUED_BEGINNER: return "matchmaking_queued_beginner";
+        case ServerGauge::MATCHMAKING_QUEUED_INTERMEDIATE: return "matchmaking_queued_intermediate";
+        case ServerGauge::MATCHMAKING_QUEUED_EXPERT: return "matchmaking_queued_expert";
+        case ServerGauge::COUNT: break;
+    }
+    return "unknown";
+}
+
+CounterRegistry& Counters() {
+    static CounterRegistry registry;
+    return registry;
+}
+
+GaugeRegistry& Gauges() {
+    static GaugeRegistry registry;
+    return registry;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "../types.h"
+#include "string.h"
+
+#include <array>
+#include <atomic>
+
+enum class ServerCounter : u8 {
+    ADMIN_CONNECTIONS_ACCEPTED,
+    ADMIN_CONNECTIONS_REJECTED,
+    ADMIN_COMMANDS,
+    MOVES_REJECTED,
+    PLAYER_CONNECTIONS_ACCEPTED,
+    PLAYER_CONNECTIONS_REJECTED,
+    ADMISSION_RATE_LIMITED,
+    ADMISSION_SHED,
+    UDP_DATAGRAMS_RECEIVED,
+    UDP_DATAGRAMS_SENT,
+    UDP_MOVES_REPLAYED,
+    UDP_DATAGRAMS_REJECTED,
+    LOG_RECORDS,
+    METRICS_REQUESTS,
+    COUNT
+};
+
+constexpr size_t SERVER_COUNTER_COUNT = static_cast<size_t>(ServerCounter::COUNT);
+
+enum class ServerGauge : u8 {
+    MATCHMAKING_QUEUED_BEGINNER,
+    MATCHMAKING_QUEUED_INTERMEDIATE,
+    MATCHMAKING_QUEUED_EXPERT,
+    COUNT
+};
+
+constexpr size_t SERVER_GAUGE_COUNT = static_cast<size_t>(ServerGauge::COUNT);
+
+StringView ToString(ServerCounter counter);
+StringView ToString(ServerGauge gauge);
+
+class CounterRegistry final {
+public:
+    friend CounterRegistry& Counters();
+
+public:
+    CounterRegistry(const CounterRegistry&) = delete;
+    CounterRegistry(CounterRegistry&&) = delete;
+    CounterRegistry& operator=(const CounterRegistry&) = delete;
+    CounterRegistry& operator=(CounterRegistry&&) = delete;
+
+    void Add(ServerCounter counter, u64 value = 1) noexcept {
+        Values[static_cast<size_t>(counter)].Value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    u64 Get(ServerCounter counter) const noexcept {
+        return Values[static_cast<size_t>(counter)].Value.load(std::memory_order_relaxed);
+    }
+
+private:
+    // One cache line per counter so unrelated hot counters don't false-share
+    struct alignas(64) Slot {
+        std::atomic<u64> Value = {0};
+    };
+
+private:
+    CounterRegistry() = default;
+
+private:
+    std::array<Slot, SERVER_COUNTER_COUNT> Values;
+};
+
+CounterRegistry& Counters();
+
+// Last written value wins, gauges are set by whoever owns the measured state
+class GaugeRegistry final {
+public:
+    friend GaugeRegistry& Gauges();
+
+public:
+    GaugeRegistry(const GaugeRegistry&) = delete;
+    GaugeRegistry(GaugeRegistry&&) = delete;
+    GaugeRegistry& operator=(const GaugeRegistry&) = delete;
+    GaugeRegistry& operator=(GaugeRegistry&&) = delete;
+
+    void Set(ServerGauge gauge, s64 value) noexcept {
+        Values[static_cast<size_t>(gauge)].store(value, std::memory_order_relaxed);
+    }
+
+    s64 Get(ServerGauge gauge) const noexcept {
+        return Values[static_cast<size_t>(gauge)].load(std::memory_order_relaxed);
+    }
+
+private:
+    GaugeRegistry() = default;
+
+private:
+    std::array<std::atomic<s64>, SERVER_GAUGE_COUNT> Values = {};
+};
+
+GaugeRegistry& Gauges();
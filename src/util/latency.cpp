@@ -0,0 +1,215 @@
+#include "latency.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace {
+    u32 Log2Floor(u64 value) noexcept {
+        u32 result = 0;
+        for (u32 shift = 32; shift > 0; shift /= 2) {
+            if (value >> shift) {
+                value >>= shift;
+                result += shift;
+            }
+        }
+        return result;
+    }
+
+    void StoreMax(std::atomic<u64>& target, u64 value) noexcept {
+        u64 current = target.load(std::memory_order_relaxed);
+        while (current < value
+               && !target.compare_exchange_weak(current, value, std::memory_order_relaxed));
+    }
+}
+
+StringView ToString(LatencyProbe probe) {
+    switch (probe) {
+        case LatencyProbe::FIELD_OPEN_CELL: return "field_open_cell";
+        case LatencyProbe::FIELD_GENERATE_MINES: return "field_generate_mines";
+        case LatencyProbe::FIELD_OPEN_NEW_CELLS: return "field_open_new_cells";
+        case LatencyProbe::SOCKET_RECEIVE: return "socket_receive";
+        case LatencyProbe::SOCKET_SEND: return "socket_send";
+        case LatencyProbe::LOG_WRITE_LOCK: return "log_write_lock";
+        case LatencyProbe::MATCHMAKING_WAIT: return "matchmaking_wait";
+        case LatencyProbe::PLAYER_COMMAND: return "player_command";
+        case LatencyProbe::COUNT: break;
+    }
+    return "unknown";
+}
+
+u32 LatencyBuckets::IndexOf(u64 value) noexcept {
+    if (value < SUB_BUCKET_COUNT) {
+        return static_cast<u32>(value);
+    }
+    const u32 exponent = Log2Floor(value);
+    const u32 subBucket = static_cast<u32>(value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1);
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + subBucket;
+}
+
+u64 LatencyBuckets::LowerBound(u32 index) noexcept {
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    const u32 exponent = index / SUB_BUCKET_COUNT + SUB_BUCKET_BITS - 1;
+    const u64 subBucket = index % SUB_BUCKET_COUNT;
+    return (SUB_BUCKET_COUNT + subBucket) << (exponent - SUB_BUCKET_BITS);
+}
+
+u64 LatencyBuckets::UpperBound(u32 index) noexcept {
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    const u32 exponent = index / SUB_BUCKET_COUNT + SUB_BUCKET_BITS - 1;
+    return LowerBound(index) + ((u64(1) << (exponent - SUB_BUCKET_BITS)) - 1);
+}
+
+void LatencySnapshot::Record(u64 value) noexcept {
+    ++Counts[LatencyBuckets::IndexOf(value)];
+    ++TotalCount;
+    Sum += value;
+    Max = std::max(Max, value);
+}
+
+void LatencySnapshot::Merge(const LatencySnapshot& other) noexcept {
+    for (size_t i = 0; i < Counts.size(); ++i) {
+        Counts[i] += other.Counts[i];
+    }
+    TotalCount += other.TotalCount;
+    Sum += other.Sum;
+    Max = std::max(Max, other.Max);
+}
+
+u64 LatencySnapshot::Percentile(f64 percentile) const noexcept {
+    if (TotalCount == 0) {
+        return 0;
+    }
+    const u64 rank = std::max<u64>(1, static_cast<u64>(percentile / 100.0 * TotalCount + 0.5));
+    u64 seen = 0;
+    for (u32 i = 0; i < Counts.size(); ++i) {
+        seen += Counts[i];
+        if (seen >= rank) {
+            return std::min(LatencyBuckets::UpperBound(i), Max);
+        }
+    }
+    return Max;
+}
+
+u64 LatencySnapshot::Mean() const noexcept {
+    return TotalCount == 0 ? 0 : Sum / TotalCount;
+}
+
+void LatencyHistogram::Record(u64 nanoseconds) noexcept {
+    Counts[LatencyBuckets::IndexOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    Sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+    StoreMax(Max, nanoseconds);
+}
+
+void LatencyHistogram::AddTo(LatencySnapshot& snapshot) const noexcept {
+    for (size_t i = 0; i < Counts.size(); ++i) {
+        const u64 count = Counts[i].load(std::memory_order_relaxed);
+        snapshot.Counts[i] += count;
+        snapshot.TotalCount += count;
+    }
+    snapshot.Sum += Sum.load(std::memory_order_relaxed);
+    snapshot.Max = std::max(snapshot.Max, Max.load(std::memory_order_relaxed));
+}
+
+void LatencyHistogram::Reset() noexcept {
+    for (auto& count : Counts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    Sum.store(0, std::memory_order_relaxed);
+    Max.store(0, std::memory_order_relaxed);
+}
+
+// Blocks are never freed: a thread that exits hands its block (and counts) to
+// the next thread that asks for one, so the list is bounded by peak thread count.
+struct LatencyRegistry::ThreadHistograms {
+    std::array<LatencyHistogram, LATENCY_PROBE_COUNT> Histograms;
+    std::atomic<bool> InUse = {true};
+    ThreadHistograms* Next = nullptr;
+};
+
+class LatencyRegistry::ThreadSlot {
+public:
+    explicit ThreadSlot(ThreadHistograms* histograms)
+        : Histograms(histograms)
+    {
+    }
+
+    ~ThreadSlot() {
+        Histograms->InUse.store(false, std::memory_order_release);
+    }
+
+    ThreadHistograms& Get() {
+        return *Histograms;
+    }
+
+private:
+    ThreadHistograms* Histograms;
+};
+
+void LatencyRegistry::Record(LatencyProbe probe, u64 nanoseconds) noexcept {
+    Local().Histograms[static_cast<size_t>(probe)].Record(nanoseconds);
+}
+
+LatencySnapshot LatencyRegistry::Collect(LatencyProbe probe) const noexcept {
+    LatencySnapshot snapshot;
+    for (auto* block = Head.load(std::memory_order_acquire); block; block = block->Next) {
+        block->Histograms[static_cast<size_t>(probe)].AddTo(snapshot);
+    }
+    return snapshot;
+}
+
+void LatencyRegistry::Reset() noexcept {
+    for (auto* block = Head.load(std::memory_order_acquire); block; block = block->Next) {
+        for (auto& histogram : block->Histograms) {
+            histogram.Reset();
+        }
+    }
+}
+
+String LatencyRegistry::Dump() const {
+#if defined(MINESWEEPER_LATENCY_PROBES)
+    std::ostringstream out;
+    for (size_t i = 0; i < LATENCY_PROBE_COUNT; ++i) {
+        const auto probe = static_cast<LatencyProbe>(i);
+        const auto snapshot = Collect(probe);
+        out << ToString(probe)
+            << " count=" << snapshot.TotalCount
+            << " mean=" << snapshot.Mean() << "ns"
+            << " p50=" << snapshot.Percentile(50) << "ns"
+            << " p90=" << snapshot.Percentile(90) << "ns"
+            << " p99=" << snapshot.Percentile(99) << "ns"
+            << " p999=" << snapshot.Percentile(99.9) << "ns"
+            << " max=" << snapshot.Max << "ns\n";
+    }
+    return out.str();
+#else
+    return "Latency probes are disabled\n";
+#endif
+}
+
+LatencyRegistry::ThreadHistograms& LatencyRegistry::Local() {
+    thread_local ThreadSlot slot(Acquire());
+    return slot.Get();
+}
+
+LatencyRegistry::ThreadHistograms* LatencyRegistry::Acquire() {
+    for (auto* block = Head.load(std::memory_order_acquire); block; block = block->Next) {
+        bool inUse = false;
+        if (block->InUse.compare_exchange_strong(inUse, true, std::memory_order_acquire)) {
+            return block;
+        }
+    }
+
+    auto* block = new ThreadHistograms();
+    block->Next = Head.load(std::memory_order_relaxed);
+    while (!Head.compare_exchange_weak(block->Next, block, std::memory_order_release));
+    return block;
+}
+
+LatencyRegistry& Latency() {
+    static LatencyRegistry registry;
+    return registry;
+}
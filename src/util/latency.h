@@ -0,0 +1,147 @@
+#pragma once
+
+#include "../types.h"
+#include "string.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+
+// Define MINESWEEPER_NO_LATENCY_PROBES to compile every LATENCY_SCOPE out
+#if !defined(MINESWEEPER_NO_LATENCY_PROBES)
+#define MINESWEEPER_LATENCY_PROBES 1
+#endif
+
+enum class LatencyProbe : u8 {
+    FIELD_OPEN_CELL,
+    FIELD_GENERATE_MINES,
+    FIELD_OPEN_NEW_CELLS,
+    SOCKET_RECEIVE,
+    SOCKET_SEND,
+    LOG_WRITE_LOCK,
+    MATCHMAKING_WAIT,
+    // From receiving a player's command line to queueing its answer
+    PLAYER_COMMAND,
+    COUNT
+};
+
+constexpr size_t LATENCY_PROBE_COUNT = static_cast<size_t>(LatencyProbe::COUNT);
+
+StringView ToString(LatencyProbe probe);
+
+// Log-bucketed histogram: values below 2^SUB_BUCKET_BITS are exact, every
+// following power of two is split into 2^SUB_BUCKET_BITS linear sub-buckets,
+// so a bucket is never wider than 1/8 of its lower bound.
+struct LatencyBuckets {
+    static constexpr u32 SUB_BUCKET_BITS = 3;
+    static constexpr u32 SUB_BUCKET_COUNT = 1u << SUB_BUCKET_BITS;
+    static constexpr u32 COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    static u32 IndexOf(u64 value) noexcept;
+    static u64 LowerBound(u32 index) noexcept;
+    static u64 UpperBound(u32 index) noexcept;
+};
+
+struct LatencySnapshot {
+    std::array<u64, LatencyBuckets::COUNT> Counts = {};
+    u64 TotalCount = 0;
+    u64 Sum = 0;
+    u64 Max = 0;
+
+    // For single-threaded tallies which don't need a LatencyHistogram
+    void Record(u64 value) noexcept;
+    void Merge(const LatencySnapshot& other) noexcept;
+    u64 Percentile(f64 percentile) const noexcept;
+    u64 Mean() const noexcept;
+};
+
+// Written by a single thread, read and reset by anyone. Counters are relaxed:
+// a snapshot taken during a write may miss that write, never tear it.
+class LatencyHistogram {
+public:
+    LatencyHistogram() = default;
+
+    void Record(u64 nanoseconds) noexcept;
+    void AddTo(LatencySnapshot& snapshot) const noexcept;
+    void Reset() noexcept;
+
+public:
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+private:
+    std::array<std::atomic<u64>, LatencyBuckets::COUNT> Counts = {};
+    std::atomic<u64> Sum = {0};
+    std::atomic<u64> Max = {0};
+};
+
+class LatencyRegistry final {
+public:
+    friend LatencyRegistry& Latency();
+
+public:
+    LatencyRegistry(const LatencyRegistry&) = delete;
+    LatencyRegistry(LatencyRegistry&&) = delete;
+    LatencyRegistry& operator=(const LatencyRegistry&) = delete;
+    LatencyRegistry& operator=(LatencyRegistry&&) = delete;
+
+    void Record(LatencyProbe probe, u64 nanoseconds) noexcept;
+
+    LatencySnapshot Collect(LatencyProbe probe) const noexcept;
+    void Reset() noexcept;
+    String Dump() const;
+
+private:
+    struct ThreadHistograms;
+    class ThreadSlot;
+
+private:
+    LatencyRegistry() = default;
+    ThreadHistograms& Local();
+    ThreadHistograms* Acquire();
+
+private:
+    std::atomic<ThreadHistograms*> Head = {nullptr};
+};
+
+LatencyRegistry& Latency();
+
+class ScopedLatencyTimer final {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit ScopedLatencyTimer(LatencyProbe probe) noexcept
+        : ScopedLatencyTimer(probe, Clock::now())
+    {
+    }
+
+    ScopedLatencyTimer(LatencyProbe probe, Clock::time_point start) noexcept
+        : Probe(probe)
+        , Start(start)
+    {
+    }
+
+    ~ScopedLatencyTimer() {
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - Start);
+        Latency().Record(Probe, static_cast<u64>(elapsed.count()));
+    }
+
+    ScopedLatencyTimer(const ScopedLatencyTimer&) = delete;
+    ScopedLatencyTimer& operator=(const ScopedLatencyTimer&) = delete;
+
+private:
+    const LatencyProbe Probe;
+    const Clock::time_point Start;
+};
+
+#define LATENCY_CONCAT_IMPL(a, b) a##b
+#define LATENCY_CONCAT(a, b) LATENCY_CONCAT_IMPL(a, b)
+
+// LATENCY_SCOPE_SINCE counts from `start` instead of the start of the scope
+#if defined(MINESWEEPER_LATENCY_PROBES)
+#define LATENCY_SCOPE(probe) ScopedLatencyTimer LATENCY_CONCAT(latencyTimer, __LINE__)(probe)
+#define LATENCY_SCOPE_SINCE(probe, start) ScopedLatencyTimer LATENCY_CONCAT(latencyTimer, __LINE__)(probe, start)
+#else
+#define LATENCY_SCOPE(probe) static_cast<void>(0)
+#define LATENCY_SCOPE_SINCE(probe, start) static_cast<void>(start)
+#endif
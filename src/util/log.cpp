@@ -5,7 +5,9 @@
 #include <mutex>
 #include <vector>
 
+#include "counters.h"
 #include "holder.h"
+#include "latency.h"
 
 constexpr auto LEVEL_ID_WARN = 0;
 constexpr auto LEVEL_ID_ERROR = 1;
@@ -76,6 +78,8 @@ LoggerLevel Logger::Debug() {
 
 void Logger::Write(const LoggerLevel& level) {
     std::lock_guard<std::mutex> guard(Impl->Mutex);
+    LATENCY_SCOPE(LatencyProbe::LOG_WRITE_LOCK);
+    Counters().Add(ServerCounter::LOG_RECORDS);
     Impl->Output << level.Level << ' ' << level.ToString() << std::endl;
 }
 
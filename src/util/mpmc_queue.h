@@ -0,0 +1,103 @@
+#pragma once
+
+#include "../types.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// Bounded lock-free multi-producer/multi-consumer queue (Vyukov). Every
+// cell carries a sequence number telling whether it is ready to be written
+// or read for the current lap, so producers and consumers only contend on
+// their own position counter and never on a lock.
+template <typename T>
+class MpmcQueue final {
+public:
+    // Capacity is rounded up to a power of two
+    explicit MpmcQueue(size_t capacity)
+        : Mask(RoundUpToPowerOfTwo(capacity) - 1)
+        , Cells(std::make_unique<Cell[]>(Mask + 1))
+    {
+        for (size_t i = 0; i <= Mask; ++i) {
+            Cells[i].Sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool TryPush(T value) {
+        size_t position = EnqueuePosition.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = Cells[position & Mask];
+            const size_t sequence = cell.Sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+            if (diff == 0) {
+                if (EnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.Value = std::move(value);
+                    cell.Sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                position = EnqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool TryPop(T& value) {
+        size_t position = DequeuePosition.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = Cells[position & Mask];
+            const size_t sequence = cell.Sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+            if (diff == 0) {
+                if (DequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    value = std::move(cell.Value);
+                    cell.Value = T();
+                    cell.Sequence.store(position + Mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                position = DequeuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Exact only while nobody pushes or pops
+    size_t Size() const noexcept {
+        const size_t enqueued = EnqueuePosition.load(std::memory_order_relaxed);
+        const size_t dequeued = DequeuePosition.load(std::memory_order_relaxed);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    size_t Capacity() const noexcept {
+        return Mask + 1;
+    }
+
+public:
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+private:
+    struct Cell {
+        std::atomic<size_t> Sequence = {0};
+        T Value = {};
+    };
+
+private:
+    const size_t Mask;
+    const std::unique_ptr<Cell[]> Cells;
+    alignas(64) std::atomic<size_t> EnqueuePosition = {0};
+    alignas(64) std::atomic<size_t> DequeuePosition = {0};
+
+private:
+    static size_t RoundUpToPowerOfTwo(size_t value) {
+        size_t result = 2;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+};
@@ -1,6 +1,7 @@
 #include "string.h"
 
 #include <cctype>
+#include <charconv>
 
 template <typename S>
 S StripBase(const S& s) {
@@ -27,3 +28,37 @@ StringView Strip(StringView view) {
 String Strip(const String& string) {
     return StripBase(string);
 }
+
+std::vector<StringView> SplitWords(StringView view) {
+    std::vector<StringView> words;
+    size_t begin = 0;
+    while (begin < view.size()) {
+        for (; begin < view.size() && isspace(view[begin]); ++begin);
+        size_t end = begin;
+        for (; end < view.size() && !isspace(view[end]); ++end);
+        if (end > begin) {
+            words.push_back(view.substr(begin, end - begin));
+        }
+        begin = end;
+    }
+    return words;
+}
+
+template <typename T>
+Maybe<T> ParseUnsignedBase(StringView view) {
+    T value = 0;
+    const auto* end = view.data() + view.size();
+    const auto [parsedEnd, error] = std::from_chars(view.data(), end, value);
+    if (error != std::errc() || parsedEnd != end) {
+        return Nothing<T>();
+    }
+    return value;
+}
+
+Maybe<u32> ParseUnsigned(StringView view) {
+    return ParseUnsignedBase<u32>(view);
+}
+
+Maybe<u64> ParseUnsigned64(StringView view) {
+    return ParseUnsignedBase<u64>(view);
+}
@@ -1,10 +1,19 @@
 #pragma once
 
+#include "../types.h"
+#include "maybe.h"
+
 #include <string>
 #include <string_view>
+#include <vector>
 
 using String = std::string;
 using StringView = std::string_view;
 
 StringView Strip(StringView view);
 String Strip(const String& string);
+
+// Splits on runs of whitespace, empty tokens are skipped
+std::vector<StringView> SplitWords(StringView view);
+Maybe<u32> ParseUnsigned(StringView view);
+Maybe<u64> ParseUnsigned64(StringView view);
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "../types.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs body(worker, index) for every index in [0, count) on `threads`
+// threads and returns when all of them are done. Every worker starts with
+// an equal slice and eats it CHUNK indices at a time from the front. A
+// worker which ran dry steals the back half of the largest slice left, so
+// uneven items (a quick explosion next to a long win) still keep every
+// core busy until the end. Slices are only locked for the few instructions
+// it takes to carve a range off, never while the body runs.
+class WorkStealingRange final {
+public:
+    static constexpr u64 CHUNK = 64;
+
+    template <typename F>
+    static void Run(u64 count, size_t threads, F&& body) {
+        threads = std::max<size_t>(1, threads);
+        WorkStealingRange range(count, threads);
+
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        for (size_t worker = 1; worker < threads; ++worker) {
+            workers.emplace_back([&range, &body, worker]() { range.Work(worker, body); });
+        }
+        range.Work(0, body);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+public:
+    WorkStealingRange(const WorkStealingRange&) = delete;
+    WorkStealingRange& operator=(const WorkStealingRange&) = delete;
+
+private:
+    struct alignas(64) Slice {
+        std::mutex Mutex;
+        u64 Begin = 0;
+        u64 End = 0;
+    };
+
+    struct Range {
+        u64 Begin = 0;
+        u64 End = 0;
+    };
+
+private:
+    WorkStealingRange(u64 count, size_t threads)
+        : Slices(std::make_unique<Slice[]>(threads))
+        , SliceCount(threads)
+    {
+        for (size_t i = 0; i < threads; ++i) {
+            Slices[i].Begin = count * i / threads;
+            Slices[i].End = count * (i + 1) / threads;
+        }
+    }
+
+    template <typename F>
+    void Work(size_t worker, F& body) {
+        for (;;) {
+            auto range = TakeChunk(worker);
+            if (range.Begin == range.End) {
+                range = Steal(worker);
+                if (range.Begin == range.End) {
+                    // Whatever is left is already owned by a running worker
+                    return;
+                }
+                Give(worker, range);
+                continue;
+            }
+            for (u64 index = range.Begin; index < range.End; ++index) {
+                body(worker, index);
+            }
+        }
+    }
+
+    Range TakeChunk(size_t worker) {
+        auto& slice = Slices[worker];
+        std::lock_guard<std::mutex> lock(slice.Mutex);
+        const u64 begin = slice.Begin;
+        slice.Begin = std::min(slice.End, begin + CHUNK);
+        return {begin, slice.Begin};
+    }
+
+    Range Steal(size_t thief) {
+        for (;;) {
+            size_t victim = SliceCount;
+            u64 largest = 0;
+            for (size_t i = 0; i < SliceCount; ++i) {
+                if (i == thief) {
+                    continue;
+                }
+                std::lock_guard<std::mutex> lock(Slices[i].Mutex);
+                const u64 left = Slices[i].End - Slices[i].Begin;
+                if (left > largest) {
+                    largest = left;
+                    victim = i;
+                }
+            }
+            if (victim == SliceCount) {
+                return {};
+            }
+
+            auto& slice = Slices[victim];
+            std::lock_guard<std::mutex> lock(slice.Mutex);
+            const u64 left = slice.End - slice.Begin;
+            if (left == 0) {
+                // The owner finished it in the meantime, look again
+                continue;
+            }
+            const u64 end = slice.End;
+            slice.End -= (left + 1) / 2;
+            return {slice.End, end};
+        }
+    }
+
+    void Give(size_t worker, Range range) {
+        auto& slice = Slices[worker];
+        std::lock_guard<std::mutex> lock(slice.Mutex);
+        slice.Begin = range.Begin;
+        slice.End = range.End;
+    }
+
+private:
+    std::unique_ptr<Slice[]> Slices;
+    const size_t SliceCount;
+};
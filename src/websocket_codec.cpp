@@ -0,0 +1,289 @@
+#include "websocket_codec.h"
+
+#include <Poco/Base64Encoder.h>
+#include <Poco/SHA1Engine.h>
+
+#include <zlib.h>
+
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    constexpr StringView ACCEPT_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    // What a sync flush ends with, RFC 7692 strips it from every message
+    constexpr StringView DEFLATE_TAIL = StringView("\x00\x00\xff\xff", 4);
+    constexpr size_t INFLATE_CHUNK = 1024;
+    constexpr size_t CONTROL_PAYLOAD_MAX = 125;
+
+    constexpr u8 FIN = 0x80;
+    constexpr u8 RSV1 = 0x40;
+    constexpr u8 RSV2_RSV3 = 0x30;
+    constexpr u8 OPCODE_MASK = 0x0f;
+    constexpr u8 MASKED = 0x80;
+    constexpr u8 LENGTH_MASK = 0x7f;
+    constexpr u8 LENGTH_16 = 126;
+    constexpr u8 LENGTH_64 = 127;
+
+    bool IsControl(WebSocketCodec::Opcode type) {
+        return static_cast<u8>(type) >= 0x8;
+    }
+
+    bool IsKnown(u8 opcode) {
+        return opcode <= 0x2 || (opcode >= 0x8 && opcode <= 0xa);
+    }
+
+    u64 ReadBigEndian(StringView data, size_t offset, size_t bytes) {
+        u64 value = 0;
+        for (size_t i = 0; i < bytes; ++i) {
+            value = (value << 8) | static_cast<u8>(data[offset + i]);
+        }
+        return value;
+    }
+
+    void AppendBigEndian(String& out, u64 value, size_t bytes) {
+        for (size_t i = bytes; i > 0; --i) {
+            out.push_back(static_cast<char>((value >> (8 * (i - 1))) & 0xff));
+        }
+    }
+
+    // Known parameters only: a server_max_window_bits below ours can't be
+    // honoured and anything unknown means an offer we don't understand
+    bool IsAcceptableDeflateOffer(StringView offer) {
+        bool isDeflate = false;
+        bool isFirst = true;
+        while (!offer.empty()) {
+            const auto end = offer.find(';');
+            const auto parameter = Strip(offer.substr(0, end));
+            offer = end == StringView::npos ? StringView() : offer.substr(end + 1);
+            if (isFirst) {
+                isDeflate = parameter == "permessage-deflate";
+                isFirst = false;
+                continue;
+            }
+            const auto name = Strip(parameter.substr(0, parameter.find('=')));
+            if (name != "client_max_window_bits" && name != "server_no_context_takeover"
+                && name != "client_no_context_takeover") {
+                return false;
+            }
+        }
+        return isDeflate;
+    }
+}
+
+String WebSocketCodec::AcceptKey(const String& clientKey) {
+    Poco::SHA1Engine sha1;
+    sha1.update(clientKey + String(ACCEPT_GUID));
+    const auto& digest = sha1.digest();
+
+    std::ostringstream out;
+    Poco::Base64Encoder base64(out);
+    base64.write(reinterpret_cast<const char*>(digest.data()), static_cast<std::streamsize>(digest.size()));
+    base64.close();
+    return out.str();
+}
+
+bool WebSocketCodec::OffersDeflate(StringView extensions) {
+    while (!extensions.empty()) {
+        const auto end = extensions.find(',');
+        if (IsAcceptableDeflateOffer(extensions.substr(0, end))) {
+            return true;
+        }
+        extensions = end == StringView::npos ? StringView() : extensions.substr(end + 1);
+    }
+    return false;
+}
+
+String WebSocketCodec::Header(Opcode type, size_t payloadSize, bool compressed) {
+    String header;
+    header.reserve(10);
+    header.push_back(static_cast<char>(FIN | (compressed ? RSV1 : 0) | static_cast<u8>(type)));
+    if (payloadSize < LENGTH_16) {
+        header.push_back(static_cast<char>(payloadSize));
+    } else if (payloadSize <= UINT16_MAX) {
+        header.push_back(static_cast<char>(LENGTH_16));
+        AppendBigEndian(header, payloadSize, 2);
+    } else {
+        header.push_back(static_cast<char>(LENGTH_64));
+        AppendBigEndian(header, payloadSize, 8);
+    }
+    return header;
+}
+
+String WebSocketCodec::CloseFrame(u16 code) {
+    auto frame = Header(Opcode::CLOSE, 2);
+    AppendBigEndian(frame, code, 2);
+    return frame;
+}
+
+WebSocketCodec::WebSocketCodec(bool deflate, size_t messageBytesMax)
+    : Deflate(deflate)
+    , MessageBytesMax(messageBytesMax)
+{
+    if (!Deflate) {
+        return;
+    }
+    // Raw deflate with the full window, the default client_max_window_bits.
+    // Snapshots are repetitive text, the fastest level shrinks them plenty.
+    Deflater = std::make_unique<z_stream_s>();
+    Inflater = std::make_unique<z_stream_s>();
+    if (deflateInit2(Deflater.get(), Z_BEST_SPEED, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("Cannot initialize deflate");
+    }
+    if (inflateInit2(Inflater.get(), -MAX_WBITS) != Z_OK) {
+        deflateEnd(Deflater.get());
+        throw std::runtime_error("Cannot initialize inflate");
+    }
+}
+
+WebSocketCodec::~WebSocketCodec() {
+    if (Deflate) {
+        deflateEnd(Deflater.get());
+        inflateEnd(Inflater.get());
+    }
+}
+
+WebSocketCodec::Status WebSocketCodec::Decode(StringView data, std::vector<Message>& messages) {
+    Pending.append(data);
+    size_t offset = 0;
+    auto status = Status::OK;
+    while (status == Status::OK && Pending.size() - offset >= 2) {
+        const StringView frame = StringView(Pending).substr(offset);
+        const u8 first = static_cast<u8>(frame[0]);
+        const u8 second = static_cast<u8>(frame[1]);
+        const u8 opcode = first & OPCODE_MASK;
+        // Clients must mask everything they send
+        if ((first & RSV2_RSV3) || !(second & MASKED) || !IsKnown(opcode)
+            || ((first & RSV1) && !Deflate)) {
+            status = Status::PROTOCOL_ERROR;
+            break;
+        }
+
+        size_t headerSize = 2;
+        u64 payloadSize = second & LENGTH_MASK;
+        if (payloadSize == LENGTH_16 || payloadSize == LENGTH_64) {
+            const size_t lengthBytes = payloadSize == LENGTH_16 ? 2 : 8;
+            if (frame.size() < headerSize + lengthBytes) {
+                break;
+            }
+            payloadSize = ReadBigEndian(frame, headerSize, lengthBytes);
+            headerSize += lengthBytes;
+        }
+        if (payloadSize > MessageBytesMax) {
+            status = Status::MESSAGE_TOO_BIG;
+            break;
+        }
+        const size_t maskOffset = headerSize;
+        headerSize += 4;
+        if (frame.size() < headerSize + payloadSize) {
+            break;
+        }
+
+        String payload(frame.substr(headerSize, payloadSize));
+        for (size_t i = 0; i < payload.size(); ++i) {
+            payload[i] = static_cast<char>(payload[i] ^ frame[maskOffset + i % 4]);
+        }
+        offset += headerSize + payloadSize;
+        status = DecodeFrame(first & FIN, first & RSV1, static_cast<Opcode>(opcode), std::move(payload), messages);
+    }
+    Pending.erase(0, offset);
+    return status;
+}
+
+Maybe<String> WebSocketCodec::Compress(StringView payload) {
+    if (!Deflate || payload.size() < DEFLATE_BYTES_MIN) {
+        return Nothing<String>();
+    }
+    deflateReset(Deflater.get());
+    String compressed(deflateBound(Deflater.get(), static_cast<uLong>(payload.size())) + DEFLATE_TAIL.size(), '\0');
+    Deflater->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(payload.data()));
+    Deflater->avail_in = static_cast<uInt>(payload.size());
+    Deflater->next_out = reinterpret_cast<Bytef*>(compressed.data());
+    Deflater->avail_out = static_cast<uInt>(compressed.size());
+    if (deflate(Deflater.get(), Z_SYNC_FLUSH) != Z_OK || Deflater->avail_in != 0) {
+        return Nothing<String>();
+    }
+
+    compressed.resize(compressed.size() - Deflater->avail_out);
+    if (compressed.size() < DEFLATE_TAIL.size()
+        || StringView(compressed).substr(compressed.size() - DEFLATE_TAIL.size()) != DEFLATE_TAIL) {
+        return Nothing<String>();
+    }
+    compressed.resize(compressed.size() - DEFLATE_TAIL.size());
+    if (compressed.size() >= payload.size()) {
+        return Nothing<String>();
+    }
+    return compressed;
+}
+
+WebSocketCodec::Status WebSocketCodec::DecodeFrame(bool isFinal, bool isCompressed, Opcode type, String payload,
+                                                   std::vector<Message>& messages) {
+    if (IsControl(type)) {
+        if (!isFinal || isCompressed || payload.size() > CONTROL_PAYLOAD_MAX) {
+            return Status::PROTOCOL_ERROR;
+        }
+        messages.push_back({type, std::move(payload)});
+        return Status::OK;
+    }
+
+    // A data message either starts a new message or continues the one in
+    // progress, never both
+    if ((type == Opcode::CONTINUATION) != FragmentType.has_value()) {
+        return Status::PROTOCOL_ERROR;
+    }
+    if (type != Opcode::CONTINUATION) {
+        FragmentType = type;
+        IsFragmentCompressed = isCompressed;
+        Fragments.clear();
+    } else if (isCompressed) {
+        return Status::PROTOCOL_ERROR;
+    }
+    if (Fragments.size() + payload.size() > MessageBytesMax) {
+        return Status::MESSAGE_TOO_BIG;
+    }
+    Fragments.append(payload);
+    if (!isFinal) {
+        return Status::OK;
+    }
+
+    Message message{*FragmentType, std::move(Fragments)};
+    FragmentType = Nothing<Opcode>();
+    Fragments.clear();
+    if (IsFragmentCompressed) {
+        const auto status = Inflate(message.Payload);
+        if (status != Status::OK) {
+            return status;
+        }
+    }
+    messages.push_back(std::move(message));
+    return Status::OK;
+}
+
+// Output is capped at MessageBytesMax, a tiny message can't inflate into a huge one
+WebSocketCodec::Status WebSocketCodec::Inflate(String& payload) {
+    payload.append(DEFLATE_TAIL);
+    inflateReset(Inflater.get());
+    Inflater->next_in = reinterpret_cast<Bytef*>(payload.data());
+    Inflater->avail_in = static_cast<uInt>(payload.size());
+
+    String inflated;
+    do {
+        const size_t produced = inflated.size();
+        if (produced > MessageBytesMax) {
+            return Status::MESSAGE_TOO_BIG;
+        }
+        inflated.resize(produced + INFLATE_CHUNK);
+        Inflater->next_out = reinterpret_cast<Bytef*>(inflated.data() + produced);
+        Inflater->avail_out = static_cast<uInt>(INFLATE_CHUNK);
+        const int result = inflate(Inflater.get(), Z_SYNC_FLUSH);
+        inflated.resize(inflated.size() - Inflater->avail_out);
+        if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+            return Status::PROTOCOL_ERROR;
+        }
+    } while (Inflater->avail_out == 0);
+
+    if (inflated.size() > MessageBytesMax) {
+        return Status::MESSAGE_TOO_BIG;
+    }
+    payload = std::move(inflated);
+    return Status::OK;
+}
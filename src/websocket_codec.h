@@ -0,0 +1,95 @@
+#pragma once
+
+#include "types.h"
+#include "util/maybe.h"
+#include "util/string.h"
+
+#include <memory>
+#include <vector>
+
+struct z_stream_s;
+
+// Server side of RFC 6455 framing over a plain stream socket, so browser
+// players run on the same BufferedConnection loop as native ones. Outgoing
+// frames are a header in front of the unchanged payload, which lets shared
+// buffers be queued as they are.
+//
+// permessage-deflate (RFC 7692) is negotiated without context takeover in
+// either direction: every message is compressed on its own, so a connection
+// keeps no compression window between messages and small ones can skip
+// compression altogether.
+class WebSocketCodec {
+public:
+    enum class Opcode : u8 {
+        CONTINUATION = 0x0,
+        TEXT = 0x1,
+        BINARY = 0x2,
+        CLOSE = 0x8,
+        PING = 0x9,
+        PONG = 0xa
+    };
+
+    enum class Status : u8 {
+        OK,
+        PROTOCOL_ERROR,
+        MESSAGE_TOO_BIG
+    };
+
+    // Fragments are joined and inflated already
+    struct Message {
+        Opcode Type = Opcode::TEXT;
+        String Payload;
+    };
+
+    static constexpr u16 CLOSE_NORMAL = 1000;
+    static constexpr u16 CLOSE_GOING_AWAY = 1001;
+    static constexpr u16 CLOSE_PROTOCOL_ERROR = 1002;
+    static constexpr u16 CLOSE_MESSAGE_TOO_BIG = 1009;
+
+    static constexpr StringView DEFLATE_EXTENSION =
+        "permessage-deflate; server_no_context_takeover; client_no_context_takeover";
+
+public:
+    // Sec-WebSocket-Accept for the client's Sec-WebSocket-Key
+    static String AcceptKey(const String& clientKey);
+    // Whether one of the offers in Sec-WebSocket-Extensions is a deflate
+    // which DEFLATE_EXTENSION can answer
+    static bool OffersDeflate(StringView extensions);
+
+    static String Header(Opcode type, size_t payloadSize, bool compressed = false);
+    static String CloseFrame(u16 code);
+
+public:
+    WebSocketCodec(bool deflate, size_t messageBytesMax);
+    ~WebSocketCodec();
+
+    // Appends complete messages found in `data` to `messages`, a partial
+    // frame is kept until the rest arrives. Nothing can be decoded after
+    // an error.
+    Status Decode(StringView data, std::vector<Message>& messages);
+
+    // Nothing when the payload should go as it is: deflate is off, the
+    // payload is too small to bother or doesn't shrink
+    Maybe<String> Compress(StringView payload);
+
+public:
+    WebSocketCodec(const WebSocketCodec&) = delete;
+    WebSocketCodec& operator=(const WebSocketCodec&) = delete;
+
+private:
+    static constexpr size_t DEFLATE_BYTES_MIN = 256;
+
+    const bool Deflate;
+    const size_t MessageBytesMax;
+    String Pending;
+    String Fragments;
+    Maybe<Opcode> FragmentType;
+    bool IsFragmentCompressed = false;
+    std::unique_ptr<z_stream_s> Deflater;
+    std::unique_ptr<z_stream_s> Inflater;
+
+private:
+    Status DecodeFrame(bool isFinal, bool isCompressed, Opcode type, String payload,
+                       std::vector<Message>& messages);
+    Status Inflate(String& payload);
+};